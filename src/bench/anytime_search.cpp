@@ -0,0 +1,56 @@
+// Deadline accuracy of the anytime search on 8x8 Connect4: for each move
+// time, searches the opening position repeatedly and reports iterations per
+// search and how far past the deadline the search returned, serially and
+// with tree-parallel threads.
+//
+// Usage: bench_anytime_search [searches] [threads]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+
+static void run(const char* label, SearchConfig config, double move_time, int searches){
+    config.reuse_tree = false;
+    SearchTree<Game> tree(config);
+    Game game;
+    game.step(3);
+    double total_over = 0, max_over = 0;
+    long long total_iters = 0;
+    for (int i = 0; i < searches; i++){
+        auto start = SearchBudget::Clock::now();
+        SearchBudget budget(SearchBudget::UNLIMITED, SearchBudget::after(move_time));
+        tree.best_move(game, budget);
+        std::chrono::duration<double> elapsed = SearchBudget::Clock::now() - start;
+        double over = elapsed.count() - move_time;
+        total_over += over;
+        max_over = std::max(max_over, over);
+        total_iters += budget.iterations();
+        tree.clear();
+    }
+    printf("%-14s %6.0f ms  %8.0f iters/search  overshoot mean %6.3f ms  max %6.3f ms\n", label,
+           move_time * 1e3, static_cast<double>(total_iters) / searches,
+           total_over / searches * 1e3, max_over * 1e3);
+}
+
+int main(int argc, char** argv){
+    int searches = argc > 1 ? atoi(argv[1]) : 20;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    MCTSNode<Game>::get_hf_net();
+
+    SearchConfig serial;
+    SearchConfig parallel;
+    parallel.mode = SearchMode::TreeParallel;
+    parallel.num_threads = threads;
+
+    for (double move_time : {0.005, 0.02, 0.1}){
+        run("serial", serial, move_time, searches);
+        run("tree-parallel", parallel, move_time, searches);
+    }
+    return 0;
+}
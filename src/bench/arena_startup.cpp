@@ -0,0 +1,61 @@
+// Arena startup cost and resident memory on 8x8 Connect4. Times creating the
+// node arena, then reports RSS next to the live tree size after a search,
+// after the tree is freed, and after the arena is trimmed.
+//
+// Usage: bench_arena_startup [num_iters]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+using SearchNode = MCTSNode<Game>;
+
+// Resident set size of this process in KB, from /proc/self/statm
+static size_t rss_kb(){
+    size_t pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+    if (fscanf(statm, "%zu %zu", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void report(const char* label, NodeArena& arena){
+    size_t tree_kb = arena.blocks_in_use() * arena.get_block_size() * NodeArena::BYTES_PER_NODE / 1024;
+    printf("%-14s rss %8zu KB  tree %8zu KB  touched %8zu KB\n",
+           label, rss_kb(), tree_kb, arena.bytes_touched() / 1024);
+}
+
+int main(int argc, char** argv){
+    int num_iters = argc > 1 ? atoi(argv[1]) : 200000;
+
+    size_t before_kb = rss_kb();
+    auto start = std::chrono::steady_clock::now();
+    NodeArena& arena = *SearchNode::get_arena();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("arena of %zu nodes (%zu MB reserved) created in %.3f ms, rss +%zu KB\n",
+           arena.get_capacity(), arena.get_capacity() * NodeArena::BYTES_PER_NODE >> 20,
+           elapsed.count() * 1e3, rss_kb() - before_kb);
+
+    Game game;
+    int opening[] = {3, 4};
+    for (int action : opening){
+        game.step(action);
+    }
+
+    SearchNode root = SearchNode::new_root(game.get_prev_player());
+    root.traverse(num_iters, game);
+    report("searched", arena);
+
+    root.delete_rec();
+    report("freed", arena);
+
+    arena.trim();
+    report("trimmed", arena);
+    return 0;
+}
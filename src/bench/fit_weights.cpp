@@ -0,0 +1,106 @@
+// Least-squares weight fitting over replay shards: positions/s of the
+// normal-equation pass for 1, 2, 4, ... threads, how far each thread
+// count's weights are from the single-threaded ones, and the gradient
+// left at the solution. Positions come from random 8x8 Connect4 games,
+// labelled with their results, in shards under a temporary directory.
+//
+// Usage: bench_fit_weights [num_positions] [max_threads]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "../regression/least_squares.hpp"
+#include "../replay_buffer.hpp"
+
+using Game = Connect4<8>;
+using Net = MCTSNode<Game>::Net;
+
+constexpr int NUM_SHARDS = 4;
+
+static void write_shards(const std::vector<std::string>& paths, long num_positions){
+    ReplayFormat format;
+    format.num_features = Net::NUM_FEATURES;
+    std::vector<std::unique_ptr<ReplayWriter>> writers;
+    for (const std::string& path : paths){
+        writers.push_back(std::make_unique<ReplayWriter>(path, format));
+    }
+    Rng rng(Rng::DEFAULT_SEED);
+    long written = 0;
+    for (int game_index = 0; written < num_positions; game_index++){
+        std::vector<Game> positions;
+        Game game;
+        while (!game.is_terminal()){
+            positions.emplace_back();
+            game.copy_to(positions.back());
+            game.step(rng.below(game.num_actions));
+        }
+        double features[Net::NUM_FEATURES];
+        for (int ply = 0; ply < static_cast<int>(positions.size()) && written < num_positions; ply++, written++){
+            MCTSNode<Game>::get_hf_net()->fill_evals(positions[ply], features);
+            ReplaySample sample;
+            sample.features = features;
+            sample.outcome = static_cast<int>(game.get_reward()[0]);
+            sample.player = positions[ply].player;
+            sample.ply = ply;
+            writers[game_index % NUM_SHARDS]->add(sample);
+        }
+    }
+}
+
+int main(int argc, char** argv){
+    long num_positions = argc > 1 ? atol(argv[1]) : 400000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("bench_fit_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::vector<std::string> paths;
+    for (int s = 0; s < NUM_SHARDS; s++){
+        paths.push_back((dir / ("shard-" + std::to_string(s) + ".rpl")).string());
+    }
+    write_shards(paths, num_positions);
+
+    std::vector<std::unique_ptr<ReplayReader>> readers;
+    std::vector<const ReplayReader*> shards;
+    for (const std::string& path : paths){
+        readers.push_back(std::make_unique<ReplayReader>(path));
+        shards.push_back(readers.back().get());
+    }
+
+    std::vector<double> reference;
+    for (int threads = 1; threads <= max_threads; threads *= 2){
+        auto start = std::chrono::steady_clock::now();
+        NormalEquations equations = accumulate(shards, threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::vector<double> w = equations.solve(1e-6);
+        if (reference.empty()) reference = w;
+        double drift = 0;
+        for (int i = 0; i < equations.n; i++){
+            drift = std::max(drift, std::fabs(w[i] - reference[i]));
+        }
+        // X^T (X w - y) per position, zero at the unregularised optimum
+        double gradient = 0;
+        for (int i = 0; i < equations.n; i++){
+            double row = -equations.xty[i];
+            for (int j = 0; j < equations.n; j++){
+                row += equations.xtx[std::min(i, j) * equations.n + std::max(i, j)] * w[j];
+            }
+            gradient = std::max(gradient, std::fabs(row) / equations.count);
+        }
+        printf("threads %2d  %lld positions in %6.1f ms  %6.1fM positions/s  mse %.5f  |w - w1| %.1e  gradient %.1e\n",
+               threads, static_cast<long long>(equations.count), elapsed.count() * 1e3,
+               equations.count / elapsed.count() / 1e6, equations.mse(w.data()), drift, gradient);
+    }
+    readers.clear();
+    fs::remove_all(dir);
+    return 0;
+}
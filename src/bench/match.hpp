@@ -0,0 +1,65 @@
+#ifndef BENCH_MATCH_HPP
+#define BENCH_MATCH_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "../mcts.hpp"
+#include "../rng.hpp"
+
+// Head-to-head games between two search configurations. Each game opens with
+// a few uniformly random plies so repeated games do not replay the same line.
+struct MatchResult {
+    int wins = 0;
+    int draws = 0;
+    int losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return games() == 0 ? 0.0 : (wins + 0.5 * draws) / games(); }
+
+    void print(const char* label) const {
+        printf("%s: +%d =%d -%d  score %.3f\n", label, wins, draws, losses, score());
+    }
+};
+
+// Plays one game and returns the result from Player0's perspective. Each side
+// keeps its own SearchTree, which follows every move played; rng draws the
+// opening plies and seeds both searches.
+template <typename Game>
+double play_game(SearchConfig player0, SearchConfig player1, int random_plies, Rng& rng){
+    player0.seed = rng.next();
+    player1.seed = rng.next();
+    SearchTree<Game> trees[2] = {SearchTree<Game>(player0), SearchTree<Game>(player1)};
+    Game game;
+    for (int ply = 0; !game.is_terminal(); ply++){
+        int action;
+        if (ply < random_plies){
+            action = rng.below(game.num_actions);
+        } else {
+            int side = game.player == Game::Player0 ? 0 : 1;
+            action = trees[side].search(game).most_visited().second;
+        }
+        game.step(action);
+        trees[0].advance(action);
+        trees[1].advance(action);
+    }
+    return game.get_reward()[Game::Player0];
+}
+
+// Plays num_games games alternating colours; results are from a's perspective.
+// seed fixes every opening and search of the match.
+template <typename Game>
+MatchResult play_match(const SearchConfig& a, const SearchConfig& b, int num_games, int random_plies = 2,
+                       uint64_t seed = Rng::DEFAULT_SEED){
+    MatchResult result;
+    Rng rng(seed);
+    for (int i = 0; i < num_games; i++){
+        double reward = (i % 2 == 0) ? play_game<Game>(a, b, random_plies, rng) : -play_game<Game>(b, a, random_plies, rng);
+        if (reward > 0) result.wins++;
+        else if (reward < 0) result.losses++;
+        else result.draws++;
+    }
+    return result;
+}
+
+#endif // BENCH_MATCH_HPP
@@ -0,0 +1,56 @@
+// Node-budgeted vs unbounded search at equal iterations on 8x8 Connect4.
+// Reports the largest tree each side held after a search, then plays a match
+// to show what pruning the least-visited subtrees costs in strength.
+//
+// Usage: bench_memory_budget [num_games] [num_iters] [max_nodes]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+
+// Largest tree, in nodes, that config keeps over one self-play game
+static size_t peak_tree_nodes(const SearchConfig& config){
+    SearchTree<Game> tree(config);
+    Game game;
+    size_t peak = 0;
+    while (!game.is_terminal()){
+        int action = tree.search(game).most_visited().second;
+        peak = std::max(peak, tree.blocks_in_use() * MCTSNode<Game>::MAX_CHILDREN);
+        game.step(action);
+        tree.advance(action);
+    }
+    return peak;
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 20;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 5000;
+    size_t max_nodes = argc > 3 ? atol(argv[3]) : 4000;
+
+    SearchConfig unbounded;
+    unbounded.num_iters = num_iters;
+
+    SearchConfig budgeted = unbounded;
+    budgeted.max_nodes = max_nodes;
+
+    size_t unbounded_peak = peak_tree_nodes(unbounded);
+    size_t budgeted_peak = peak_tree_nodes(budgeted);
+    printf("peak tree: unbounded %zu nodes (%zu KB), budget %zu -> %zu nodes (%zu KB)\n",
+           unbounded_peak, unbounded_peak * NodeArena::BYTES_PER_NODE / 1024,
+           max_nodes, budgeted_peak, budgeted_peak * NodeArena::BYTES_PER_NODE / 1024);
+
+    auto start = std::chrono::steady_clock::now();
+    MatchResult result = play_match<Game>(budgeted, unbounded, num_games);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%d games, %d iters/move, budget of %zu nodes vs unbounded\n", num_games, num_iters, max_nodes);
+    result.print("budgeted");
+    printf("elapsed %.1fs\n", elapsed.count());
+    return 0;
+}
@@ -0,0 +1,219 @@
+// Microbenchmarks of the hot paths, one number each, with JSON output and a
+// comparison against a stored baseline (see microbench.hpp for the flags):
+// Connect4 step/copy_to/is_terminal, HF_Net::forward, forward_batch and
+// every feature, ucb_select, backup (what update_recursive became), node
+// allocation through ThreadSafeBatchMalloc and NodeArena under 1..N
+// threads, and whole search iterations through traverse.
+//
+// make bench-check compares a run with src/bench/baseline.json and fails
+// on a regression; make bench-baseline rewrites that file on this machine.
+//
+// Usage: bench_micro [--filter s] [--json path] [--baseline path] [--threshold percent]
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "../thread_safe_batch_malloc.hpp"
+#include "microbench.hpp"
+
+using Game = Connect4<8>;
+using SearchNode = MCTSNode<Game>;
+using Net = SearchNode::Net;
+
+static const char* FEATURE_NAMES[Net::NUM_FEATURES] = {
+    "open3", "open2", "threat", "center_control", "blocking", "height_advantage", "connectivity", "fork",
+    "tempo", "edge_avoidance", "trap", "mobility", "structure", "defensive_pattern", "endgame"};
+
+// Random games, and every non-terminal position of them past the first two plies
+struct Corpus {
+    std::vector<std::vector<int>> games;
+    std::vector<Game> positions;
+
+    explicit Corpus(int num_games){
+        Rng rng(Rng::DEFAULT_SEED);
+        for (int g = 0; g < num_games; g++){
+            Game game;
+            std::vector<int> actions;
+            while (actions.size() < 2 || !game.is_terminal()){
+                if (actions.size() >= 2) {
+                    positions.emplace_back();
+                    game.copy_to(positions.back());
+                }
+                actions.push_back(rng.below(game.num_actions));
+                game.step(actions.back());
+            }
+            games.push_back(actions);
+        }
+    }
+};
+
+// Runs ops calls of op split across num_threads threads, op(thread)
+template <typename Op>
+static void threaded(int num_threads, int64_t ops, Op op){
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++){
+        threads.emplace_back([&, t]() {
+            for (int64_t i = t; i < ops; i += num_threads){
+                op(t);
+            }
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+}
+
+// A searched tree, for selection and backup over real statistics
+struct Tree {
+    Game game;
+    SearchNode root;
+    SearchNode::Path path;
+
+    Tree(){
+        int opening[] = {3, 4, 4, 3};
+        for (int action : opening){
+            game.step(action);
+        }
+        root = SearchNode::new_root(game.get_prev_player());
+        root.traverse(20000, game);
+        // The most visited line, as a descent would record it
+        for (SearchNode node = root; !node.is_null(); node = node.most_visited().first){
+            path.push_back(node);
+            if (node.children() == NULL_NODE) break;
+        }
+    }
+
+    ~Tree(){
+        root.delete_rec();
+    }
+};
+
+int main(int argc, char** argv){
+    MicroSuite suite(argc, argv);
+    Corpus corpus(64);
+    const std::vector<Game>& positions = corpus.positions;
+    size_t n = positions.size();
+    int max_threads = std::max(4u, std::thread::hardware_concurrency());
+    volatile double sink = 0;
+
+    // Each op is one step; replaying a game from the start costs one Game() per game
+    suite.add("connect4.step", [&](int64_t ops) {
+        int64_t done = 0;
+        for (size_t g = 0; done < ops; g = (g + 1) % corpus.games.size()){
+            Game game;
+            for (int action : corpus.games[g]){
+                game.step(action);
+                asm volatile("" : : "r"(&game) : "memory");
+            }
+            done += corpus.games[g].size();
+            sink = sink + game.num_actions;
+        }
+    });
+    suite.add("connect4.copy_to", [&](int64_t ops) {
+        Game copy;
+        for (int64_t i = 0; i < ops; i++){
+            const_cast<Game&>(positions[i % n]).copy_to(copy);
+            asm volatile("" : : "r"(&copy) : "memory");
+        }
+    });
+    suite.add("connect4.is_terminal", [&](int64_t ops) {
+        int terminal = 0;
+        for (int64_t i = 0; i < ops; i++){
+            terminal += const_cast<Game&>(positions[i % n]).is_terminal();
+        }
+        sink = sink + terminal;
+    });
+
+    Net* net = SearchNode::get_hf_net();
+    suite.add("hf_net.forward", [&](int64_t ops) {
+        double sum = 0;
+        for (int64_t i = 0; i < ops; i++){
+            sum += net->forward(positions[i % n])[0];
+        }
+        sink = sink + sum;
+    });
+    suite.add("hf_net.forward_batch(per position)", [&](int64_t ops) {
+        Game::RewardT out[Net::MAX_BATCH];
+        double sum = 0;
+        for (int64_t i = 0; i < ops; i += Net::MAX_BATCH){
+            size_t first = i % (n - Net::MAX_BATCH);
+            net->forward_batch(&positions[first], Net::MAX_BATCH, out);
+            sum += out[0][0];
+        }
+        sink = sink + sum;
+    });
+    for (int f = 0; f < Net::NUM_FEATURES; f++){
+        auto feature = net->fptr[f];
+        suite.add(std::string("hf_net.feature.") + FEATURE_NAMES[f], [&, feature](int64_t ops) {
+            double sum = 0;
+            for (int64_t i = 0; i < ops; i++){
+                sum += (net->*feature)(positions[i % n]);
+            }
+            sink = sink + sum;
+        });
+    }
+
+    // A searched tree, built only if a case on it runs
+    std::unique_ptr<Tree> tree;
+    if (suite.selected("mcts.ucb_select") || suite.selected("mcts.backup")) {
+        tree = std::make_unique<Tree>();
+    }
+    NodeArena& arena = *SearchNode::get_arena();
+    suite.add("mcts.ucb_select", [&](int64_t ops) {
+        SearchNode root = tree->root;
+        NodeId block = root.children();
+        int sum = 0;
+        for (int64_t i = 0; i < ops; i++){
+            int action = root.ucb_select(block);
+            arena.virtual_loss[block + action].fetch_sub(1, std::memory_order_relaxed);
+            sum += action;
+        }
+        sink = sink + sum;
+    });
+    // Along the most visited line. backup takes a virtual loss off every
+    // node below the root, so each op first puts one on, as descend does.
+    suite.add("mcts.backup", [&](int64_t ops) {
+        const SearchNode::Path& path = tree->path;
+        Game::RewardT result{1, -1};
+        for (int64_t i = 0; i < ops; i++){
+            for (size_t d = 1; d < path.size(); d++){
+                arena.virtual_loss[path[d].id].fetch_add(1, std::memory_order_relaxed);
+            }
+            SearchNode::backup(path, result);
+            result[0] = -result[0];
+            result[1] = -result[1];
+        }
+    });
+
+    struct Block {
+        char bytes[64];
+    };
+    std::vector<std::unique_ptr<ThreadSafeBatchMalloc<Block>>> pools;
+    for (int threads = 1; threads <= max_threads; threads *= 2){
+        std::string suffix = "(" + std::to_string(threads) + " threads)";
+        pools.push_back(std::make_unique<ThreadSafeBatchMalloc<Block>>(1024));
+        ThreadSafeBatchMalloc<Block>* pool = pools.back().get();
+        suite.add("alloc.batch_malloc.safe_pop+push" + suffix, [threads, pool](int64_t ops) {
+            threaded(threads, ops, [pool](int) { pool->push(pool->safe_pop()); });
+        });
+        suite.add("alloc.node_arena.allocate+release" + suffix, [threads, &arena](int64_t ops) {
+            threaded(threads, ops, [&arena](int) { arena.release(arena.allocate()); });
+        });
+    }
+
+    // Fresh trees of ITERS iterations, so the per-iteration cost does not drift with tree size
+    constexpr int ITERS = 2000;
+    suite.add("search.traverse(iteration)", [&](int64_t ops) {
+        Game game = positions[0];
+        for (int64_t done = 0; done < ops; done += ITERS){
+            SearchNode root = SearchNode::new_root(game.get_prev_player());
+            root.traverse(static_cast<int>(std::min<int64_t>(ITERS, ops - done)), game);
+            root.delete_rec();
+        }
+    });
+    return suite.finish();
+}
@@ -0,0 +1,155 @@
+#ifndef MICROBENCH_HPP
+#define MICROBENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Timing harness for bench_micro. A case is a body that performs a given
+// number of operations. Each case's count doubles until one call takes
+// MIN_SECONDS; then ROUNDS rounds time every case once in turn, and a case
+// keeps its fastest call as ns per operation. Interleaving the rounds
+// spreads each case's samples over the whole run, so a stretch where the
+// machine runs slow does not land on a few cases only.
+//
+// Results print as a table and can be written as JSON, one case per line.
+// They can also be compared with a JSON file from an earlier run on the
+// same machine. A case slower than its baseline by more than the threshold
+// is a regression, and finish() then returns 1.
+//
+// Flags: --filter <substring> --json <path, - for stdout>
+//        --baseline <path> --threshold <percent, default 15>
+class MicroSuite {
+    public:
+    static constexpr double MIN_SECONDS = 0.02;
+    static constexpr int ROUNDS = 15;
+
+    MicroSuite(int argc, char** argv){
+        for (int i = 1; i + 1 < argc; i += 2){
+            if (strcmp(argv[i], "--filter") == 0) filter = argv[i + 1];
+            else if (strcmp(argv[i], "--json") == 0) json_path = argv[i + 1];
+            else if (strcmp(argv[i], "--baseline") == 0) baseline_path = argv[i + 1];
+            else if (strcmp(argv[i], "--threshold") == 0) threshold = atof(argv[i + 1]);
+        }
+        // Keep stdout clean for the JSON
+        table = json_path == "-" ? stderr : stdout;
+        if (!baseline_path.empty()) read_baseline();
+    }
+
+    // True if name passes --filter; lets a caller skip a case's setup
+    bool selected(const std::string& name) const {
+        return name.find(filter) != std::string::npos;
+    }
+
+    // Registers body(ops), which must perform ops operations. Whatever it
+    // refers to must live until finish().
+    void add(const std::string& name, std::function<void(int64_t)> body){
+        if (selected(name)) cases.push_back({name, std::move(body), 1, 0});
+    }
+
+    // Times the cases, prints them, writes the JSON and compares with the
+    // baseline; returns the process exit code
+    int finish(){
+        for (Case& c : cases){
+            while (seconds(c, c.ops) < MIN_SECONDS){
+                c.ops *= 2;
+            }
+            c.best = seconds(c, c.ops);
+        }
+        for (int round = 1; round < ROUNDS; round++){
+            for (Case& c : cases){
+                c.best = std::min(c.best, seconds(c, c.ops));
+            }
+        }
+        int regressions = 0;
+        for (Case& c : cases){
+            double ns = c.best * 1e9 / c.ops;
+            fprintf(table, "%-44s %12.2f ns/op %14.0f ops/s", c.name.c_str(), ns, 1e9 / ns);
+            auto base = baseline.find(c.name);
+            if (base != baseline.end()) {
+                double change = (ns / base->second - 1) * 100;
+                bool regressed = change > threshold;
+                regressions += regressed;
+                fprintf(table, "  %+6.1f%%%s", change, regressed ? "  REGRESSION" : "");
+            }
+            fprintf(table, "\n");
+        }
+        if (!json_path.empty()) write_json();
+        if (!baseline_path.empty()) {
+            fprintf(table, "%d of %zu cases slower than %s by more than %.0f%%\n", regressions, cases.size(),
+                    baseline_path.c_str(), threshold);
+        }
+        return regressions > 0 ? 1 : 0;
+    }
+
+    private:
+    struct Case {
+        std::string name;
+        std::function<void(int64_t)> body;
+        int64_t ops;
+        double best; // Seconds for ops operations
+    };
+
+    std::string filter;
+    std::string json_path;
+    std::string baseline_path;
+    double threshold = 15;
+    std::map<std::string, double> baseline;
+    std::vector<Case> cases;
+    FILE* table;
+
+    static double seconds(Case& c, int64_t ops){
+        auto start = std::chrono::steady_clock::now();
+        c.body(ops);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // Reads back the lines write_json writes
+    void read_baseline(){
+        std::ifstream file(baseline_path);
+        if (!file) {
+            fprintf(stderr, "Error: cannot read baseline %s\n", baseline_path.c_str());
+            exit(1);
+        }
+        std::string line;
+        while (std::getline(file, line)){
+            size_t name = line.find("\"name\": \"");
+            size_t ns = line.find("\"ns_per_op\": ");
+            if (name == std::string::npos || ns == std::string::npos) continue;
+            name += 9;
+            baseline[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + ns + 13);
+        }
+    }
+
+    void write_json() const {
+        FILE* out = json_path == "-" ? stdout : fopen(json_path.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Error: cannot write %s\n", json_path.c_str());
+            return;
+        }
+        fprintf(out, "{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < cases.size(); i++){
+            const Case& c = cases[i];
+            double ns = c.best * 1e9 / c.ops;
+            fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f", c.name.c_str(), ns, 1e9 / ns);
+            auto base = baseline.find(c.name);
+            if (base != baseline.end()) {
+                fprintf(out, ", \"baseline_ns_per_op\": %.3f, \"ratio\": %.4f", base->second, ns / base->second);
+            }
+            fprintf(out, "}%s\n", i + 1 < cases.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        if (out != stdout) fclose(out);
+    }
+};
+
+#endif // MICROBENCH_HPP
@@ -0,0 +1,42 @@
+// Tree-parallel scaling: iterations/sec of traverse_parallel on one 8x8
+// Connect4 middlegame position for 1, 2, 4, ... threads.
+//
+// Usage: bench_parallel_scaling [num_iters] [max_threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+int main(int argc, char** argv){
+    using Game = Connect4<8>;
+    int num_iters = argc > 1 ? atoi(argv[1]) : 20000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : std::max(16u, std::thread::hardware_concurrency());
+
+    Game game;
+    int opening[] = {3, 4, 3, 4, 2, 5, 4, 3};
+    for (int action : opening){
+        game.step(action);
+    }
+
+    // Warm up the arena so its startup cost is not timed
+    MCTSNode<Game>::get_arena();
+    MCTSNode<Game>::get_hf_net();
+
+    double base_rate = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2){
+        MCTSNode<Game> root = MCTSNode<Game>::new_root(game.get_prev_player());
+        auto start = std::chrono::steady_clock::now();
+        root.traverse_parallel(num_iters, game, threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double rate = num_iters / elapsed.count();
+        if (threads == 1) base_rate = rate;
+        auto [best_child, best_action] = root.most_visited();
+        printf("threads %2d  %10.0f iters/s  speedup %5.2fx  best %d (%d visits)\n",
+               threads, rate, rate / base_rate, game.action_map[best_action], best_child.n_visits());
+        root.delete_rec();
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Pondering on 8x8 Connect4: a time-limited engine plays an opponent that
+// searches a fixed number of iterations and then thinks on for a while,
+// once pondering on the opponent's time and once idle. Reports the visits
+// each search inherits at its root, the iterations pondered per move and
+// the match results.
+//
+// Usage: bench_ponder [num_games] [move_ms] [opponent_iters] [opponent_think_ms]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+
+struct PonderStats {
+    long long searches = 0;
+    long long inherited = 0; // Root visits already there when a search began
+    long long pondered = 0;
+};
+
+// Plays one game, ours moving first if ours_first; returns the result from our side
+static double play_game(const SearchConfig& ours, const SearchConfig& theirs, bool ponder, bool ours_first,
+                        double think_time, Rng& rng, PonderStats& stats){
+    SearchConfig our_config = ours, their_config = theirs;
+    our_config.seed = rng.next();
+    their_config.seed = rng.next();
+    SearchTree<Game> us(our_config), them(their_config);
+    Game game;
+    int our_side = ours_first ? Game::Player0 : Game::Player1;
+    for (int ply = 0; !game.is_terminal(); ply++){
+        int action;
+        if (ply < 2){
+            action = rng.below(game.num_actions);
+        } else if (game.player == our_side){
+            stats.searches++;
+            stats.inherited += us.root.is_null() ? 0 : us.root.n_visits();
+            action = us.search(game).most_visited().second;
+        } else {
+            action = them.search(game).most_visited().second;
+            std::this_thread::sleep_for(std::chrono::duration<double>(think_time));
+            stats.pondered += us.stop_pondering();
+        }
+        game.step(action);
+        us.advance(action);
+        them.advance(action);
+        if (ponder && game.player != our_side && !game.is_terminal()){
+            us.ponder(game);
+        }
+    }
+    return game.get_reward()[our_side];
+}
+
+static void run(const char* label, const SearchConfig& ours, const SearchConfig& theirs, bool ponder,
+                int num_games, double think_time){
+    MatchResult result;
+    PonderStats stats;
+    Rng rng;
+    for (int g = 0; g < num_games; g++){
+        double reward = play_game(ours, theirs, ponder, g % 2 == 0, think_time, rng, stats);
+        if (reward > 0) result.wins++;
+        else if (reward < 0) result.losses++;
+        else result.draws++;
+    }
+    printf("%-8s inherited %7.0f visits/search  pondered %7.0f iters/move  ", label,
+           static_cast<double>(stats.inherited) / stats.searches, static_cast<double>(stats.pondered) / stats.searches);
+    result.print("vs opponent");
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 20;
+    double move_time = (argc > 2 ? atof(argv[2]) : 20) / 1e3;
+    int opponent_iters = argc > 3 ? atoi(argv[3]) : 1000;
+    double think_time = (argc > 4 ? atof(argv[4]) : 50) / 1e3;
+
+    SearchConfig ours;
+    ours.num_iters = 0;
+    ours.time_limit = move_time;
+
+    SearchConfig theirs;
+    theirs.num_iters = opponent_iters;
+
+    MCTSNode<Game>::get_hf_net();
+    printf("%d games, %.0f ms/move against %d iters/move + %.0f ms thinking\n", num_games, move_time * 1e3,
+           opponent_iters, think_time * 1e3);
+    run("idle", ours, theirs, false, num_games, think_time);
+    run("ponder", ours, theirs, true, num_games, think_time);
+    return 0;
+}
@@ -0,0 +1,60 @@
+// PUCT vs UCT selection on 8x8 Connect4. Plays PUCT at a fraction of UCT's
+// iterations per move, then both at UCT's count, and reports each side's
+// search rate so the cost of computing priors shows.
+//
+// Usage: bench_puct_strength [num_games] [num_iters] [puct_fraction]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+
+// Iterations/sec of config over one self-play game
+static double search_rate(const SearchConfig& config){
+    SearchTree<Game> tree(config);
+    Game game;
+    long long iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!game.is_terminal()){
+        SearchBudget budget(config);
+        int action = tree.search(game, budget).most_visited().second;
+        iterations += budget.iterations();
+        game.step(action);
+        tree.advance(action);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return iterations / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 20;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 2000;
+    double puct_fraction = argc > 3 ? atof(argv[3]) : 0.25;
+
+    SearchConfig uct;
+    uct.num_iters = num_iters;
+
+    SearchConfig puct = uct;
+    puct.selection = SelectionRule::PUCT;
+
+    SearchConfig puct_reduced = puct;
+    puct_reduced.num_iters = static_cast<int>(num_iters * puct_fraction);
+
+    printf("search rate: UCT %.0f iters/s, PUCT %.0f iters/s\n", search_rate(uct), search_rate(puct));
+
+    auto start = std::chrono::steady_clock::now();
+    MatchResult reduced = play_match<Game>(puct_reduced, uct, num_games);
+    printf("%d games, PUCT at %d iters/move vs UCT at %d\n", num_games, puct_reduced.num_iters, num_iters);
+    reduced.print("PUCT");
+
+    MatchResult equal = play_match<Game>(puct, uct, num_games);
+    printf("%d games, PUCT vs UCT at %d iters/move\n", num_games, num_iters);
+    equal.print("PUCT");
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("elapsed %.1fs\n", elapsed.count());
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Training-data writes: the old scheme, every thread reopening one shared
+// CSV per record and appending a text line, against a ReplayWriter per
+// thread on its own shard; then a scan of the shards through ReplayReader.
+// Files go to a temporary directory that is removed afterwards.
+//
+// Usage: bench_replay_writer [records_per_thread] [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "../replay_buffer.hpp"
+
+using Game = Connect4<8>;
+using Net = MCTSNode<Game>::Net;
+
+// Positions from a random game, features precomputed so only writing is timed
+struct Positions {
+    std::vector<Game> games;
+    std::vector<std::vector<double>> features;
+
+    Positions(){
+        Rng rng(Rng::DEFAULT_SEED);
+        Game game;
+        while (!game.is_terminal()){
+            games.emplace_back();
+            game.copy_to(games.back());
+            features.emplace_back(Net::NUM_FEATURES);
+            MCTSNode<Game>::get_hf_net()->fill_evals(game, features.back().data());
+            game.step(rng.below(game.num_actions));
+        }
+    }
+};
+
+template <typename Write>
+static double write_rate(int num_threads, long records, Write write){
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++){
+        threads.emplace_back([&, t]() { write(t, records); });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_threads * records / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    long records = argc > 1 ? atol(argv[1]) : 20000;
+    int num_threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    Positions positions;
+    size_t n = positions.games.size();
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("bench_replay_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string csv = (dir / "game_data.csv").string();
+
+    double csv_rate = write_rate(num_threads, records, [&](int, long count) {
+        for (long i = 0; i < count; i++){
+            std::ofstream file(csv, std::ios::app);
+            for (double feature : positions.features[i % n]){
+                file << feature << ",";
+            }
+            file << 1 << std::endl;
+        }
+    });
+
+    ReplayFormat format;
+    format.num_features = Net::NUM_FEATURES;
+    format.board_bytes = sizeof(Game::state);
+    format.num_actions = Game::MAX_ACTIONS;
+    format.flags = ReplayFormat::HAS_BOARD | ReplayFormat::HAS_VISITS;
+    uint32_t visits[Game::MAX_ACTIONS] = {100, 200, 300, 400, 300, 200, 100, 50};
+    auto shard = [&](int t) { return (dir / ("shard-" + std::to_string(t) + ".rpl")).string(); };
+    double binary_rate = write_rate(num_threads, records, [&](int t, long count) {
+        ReplayWriter writer(shard(t), format);
+        for (long i = 0; i < count; i++){
+            ReplaySample sample;
+            sample.features = positions.features[i % n].data();
+            sample.outcome = 1;
+            sample.player = positions.games[i % n].player;
+            sample.ply = static_cast<int>(i % n);
+            sample.board = positions.games[i % n].state;
+            sample.visits = visits;
+            writer.add(sample);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    double sum = 0;
+    size_t read = 0;
+    for (int t = 0; t < num_threads; t++){
+        ReplayReader reader(shard(t));
+        for (size_t i = 0; i < reader.size(); i++){
+            ReplayRecord record = reader[i];
+            for (uint32_t f = 0; f < format.num_features; f++){
+                sum += record.features()[f];
+            }
+            sum += record.outcome();
+        }
+        read += reader.size();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    size_t total = num_threads * records;
+    printf("%d threads x %ld records\n", num_threads, records);
+    printf("  CSV, reopened per record  %8.0f records/s  %5.1f bytes/record\n", csv_rate,
+           static_cast<double>(fs::file_size(csv)) / total);
+    printf("  ReplayWriter shards       %8.0f records/s  %5.1f bytes/record (%u features, board, visits)  %.0fx\n",
+           binary_rate, static_cast<double>(format.record_size()), format.num_features, binary_rate / csv_rate);
+    printf("  ReplayReader scan         %8.0f records/s  (%zu records, checksum %.1f)\n",
+           read / elapsed.count(), read, sum);
+    fs::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Random column draws per second: glibc rand() % n, which takes a global
+// lock, against a per-thread Rng::below(n), for 1, 2, 4, ... threads.
+//
+// Usage: bench_rng [draws_per_thread] [max_threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "../rng.hpp"
+
+// Runs draw on num_threads threads, draws times each; returns draws/sec
+template <typename Draw>
+static double draw_rate(int num_threads, long draws, Draw draw){
+    std::vector<std::thread> threads;
+    std::vector<long> sums(num_threads);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++){
+        threads.emplace_back([&, t]() {
+            Rng rng(Rng::stream_seed(Rng::DEFAULT_SEED, t));
+            long sum = 0;
+            for (long i = 0; i < draws; i++){
+                sum += draw(rng, 1 + i % 8);
+            }
+            sums[t] = sum;
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_threads * draws / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    long draws = argc > 1 ? atol(argv[1]) : 20000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2){
+        double libc = draw_rate(threads, draws, [](Rng&, long n) { return static_cast<long>(rand() % n); });
+        double own = draw_rate(threads, draws, [](Rng& rng, long n) { return static_cast<long>(rng.below(n)); });
+        printf("threads %2d  rand() %%  %6.1f M/s  Rng::below %7.1f M/s  %5.1fx\n",
+               threads, libc / 1e6, own / 1e6, own / libc);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Random playouts per second on 8x8 Connect4: stepping a Game copy move by
+// move against PlayoutKernel, for one leaf's NUM_ROLLOUTS playouts at a time
+// and for a batch of leaves at once, then the search rate it gives.
+//
+// Usage: bench_rollout_kernel [num_positions] [batch_size]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+using RewardT = Game::RewardT;
+
+static std::vector<Game> random_positions(int count, Rng& rng){
+    std::vector<Game> positions(count);
+    for (Game& game : positions){
+        int plies = rng.below(20);
+        for (int i = 0; i < plies && !game.is_terminal(); i++){
+            game.step(rng.below(game.num_actions));
+        }
+    }
+    return positions;
+}
+
+// Playouts/sec of play over positions, batch positions per call
+template <typename Play>
+static double playout_rate(std::vector<Game>& positions, int batch, Play play){
+    std::vector<RewardT> rewards(batch);
+    double checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first + batch <= positions.size(); first += batch){
+        play(&positions[first], batch, rewards.data());
+        checksum += rewards[0][0];
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum == 1e300) printf("\n");
+    return static_cast<double>(positions.size() / batch * batch) * NUM_ROLLOUTS / elapsed.count();
+}
+
+static double search_rate(int batch_size){
+    SearchConfig config;
+    config.num_iters = 20000;
+    config.batch_size = batch_size;
+    config.reuse_tree = false;
+    SearchTree<Game> tree(config);
+    Game game;
+    game.step(3);
+    auto start = std::chrono::steady_clock::now();
+    SearchBudget budget(config);
+    tree.best_move(game, budget);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return config.num_iters / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    int num_positions = argc > 1 ? atoi(argv[1]) : 20000;
+    int batch_size = argc > 2 ? atoi(argv[2]) : 16;
+
+    Rng rng;
+    std::vector<Game> positions = random_positions(num_positions, rng);
+
+    auto scalar = [&](Game* games, int count, RewardT* rewards) {
+        Game rollout;
+        for (int j = 0; j < count; j++){
+            RewardT total = {0, 0};
+            for (int i = 0; i < NUM_ROLLOUTS; i++){
+                games[j].copy_to(rollout);
+                while (!rollout.is_terminal()){
+                    rollout.step(rng.below(rollout.num_actions));
+                }
+                total += rollout.get_reward();
+            }
+            rewards[j] = total / NUM_ROLLOUTS;
+        }
+    };
+    auto kernel = [&](Game* games, int count, RewardT* rewards) {
+        PlayoutKernel<Game>::play(games, count, NUM_ROLLOUTS, rng, rewards);
+    };
+
+    double scalar_rate = playout_rate(positions, 1, scalar);
+    double single_rate = playout_rate(positions, 1, kernel);
+    double batch_rate = playout_rate(positions, batch_size, kernel);
+    printf("scalar                %6.2f M playouts/s\n", scalar_rate / 1e6);
+    printf("kernel, 1 leaf        %6.2f M playouts/s  %5.1fx\n", single_rate / 1e6, single_rate / scalar_rate);
+    printf("kernel, %2d leaves     %6.2f M playouts/s  %5.1fx\n", batch_size, batch_rate / 1e6, batch_rate / scalar_rate);
+
+    MCTSNode<Game>::get_hf_net();
+    printf("search: %.0f iters/s serial, %.0f iters/s batch %d\n", search_rate(1), search_rate(batch_size), batch_size);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Uniform vs tactical rollouts on 8x8 Connect4: per-playout variance of the
+// result and the share of positions the playouts already score as decided,
+// over random mid-game positions, with each policy's playout and search
+// rates; then a match at a fixed time per move.
+//
+// Usage: bench_rollout_policy [num_games] [move_ms] [num_positions]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+using RewardT = Game::RewardT;
+
+static const int PLAYOUTS_PER_POSITION = 2000;
+
+// Positions 6 to 25 random plies in that are not over
+static std::vector<Game> random_positions(int count, Rng& rng){
+    std::vector<Game> positions;
+    while (static_cast<int>(positions.size()) < count){
+        Game game;
+        int plies = 6 + rng.below(20);
+        for (int i = 0; i < plies && !game.is_terminal(); i++){
+            game.step(rng.below(game.num_actions));
+        }
+        if (!game.is_terminal()) positions.push_back(game);
+    }
+    return positions;
+}
+
+static void playout_stats(const char* label, std::vector<Game>& positions, RolloutPolicy policy, Rng& rng){
+    double variance = 0;
+    int decided = 0;
+    for (Game& position : positions){
+        long wins = 0, losses = 0;
+        for (int i = 0; i < PLAYOUTS_PER_POSITION; i++){
+            RewardT outcome;
+            PlayoutKernel<Game>::play(&position, 1, 1, rng, &outcome, policy);
+            wins += outcome[0] > 0;
+            losses += outcome[0] < 0;
+        }
+        // Outcomes are +1, 0 or -1, so the mean square is the decisive share
+        double q = static_cast<double>(wins - losses) / PLAYOUTS_PER_POSITION;
+        variance += static_cast<double>(wins + losses) / PLAYOUTS_PER_POSITION - q * q;
+        decided += std::fabs(q) == 1.0;
+    }
+    int total = static_cast<int>(positions.size()) * PLAYOUTS_PER_POSITION;
+    std::vector<RewardT> rewards(positions.size());
+    auto start = std::chrono::steady_clock::now();
+    PlayoutKernel<Game>::play(positions.data(), static_cast<int>(positions.size()), PLAYOUTS_PER_POSITION, rng,
+                              rewards.data(), policy);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    variance /= positions.size();
+    printf("%-9s variance/playout %.3f  of a %d-playout estimate %.4f  decided %5.1f%%  %6.2f M playouts/s\n",
+           label, variance, NUM_ROLLOUTS, variance / NUM_ROLLOUTS, 100.0 * decided / positions.size(),
+           total / elapsed.count() / 1e6);
+}
+
+static double search_rate(SearchConfig config){
+    config.num_iters = 10000;
+    config.time_limit = 0;
+    config.reuse_tree = false;
+    SearchTree<Game> tree(config);
+    Game game;
+    game.step(3);
+    game.step(4);
+    SearchBudget budget(config);
+    auto start = std::chrono::steady_clock::now();
+    tree.best_move(game, budget);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return config.num_iters / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 40;
+    double move_time = (argc > 2 ? atof(argv[2]) : 20) / 1e3;
+    int num_positions = argc > 3 ? atoi(argv[3]) : 200;
+
+    Rng rng;
+    std::vector<Game> positions = random_positions(num_positions, rng);
+    playout_stats("uniform", positions, RolloutPolicy::Uniform, rng);
+    playout_stats("tactical", positions, RolloutPolicy::Tactical, rng);
+
+    SearchConfig uniform;
+    uniform.num_iters = 0;
+    uniform.time_limit = move_time;
+    uniform.rollout = RolloutPolicy::Uniform;
+
+    SearchConfig tactical = uniform;
+    tactical.rollout = RolloutPolicy::Tactical;
+
+    MCTSNode<Game>::get_hf_net();
+    printf("search rate: uniform %.0f iters/s, tactical %.0f iters/s\n", search_rate(uniform), search_rate(tactical));
+
+    auto start = std::chrono::steady_clock::now();
+    MatchResult result = play_match<Game>(tactical, uniform, num_games);
+    printf("%d games, %.0f ms/move, tactical vs uniform rollouts\n", num_games, move_time * 1e3);
+    result.print("tactical");
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("elapsed %.1fs\n", elapsed.count());
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Root-parallel vs serial search at equal total iterations on 8x8 Connect4.
+// Both sides get num_iters per move; the root-parallel side splits them over
+// num_threads private trees. First checks budgets too small to go round
+// the threads, fewer than two iterations each: every search must still
+// leave a move to play, and advancing must take the statistics merged from
+// the helper trees back out of the root's children.
+//
+// Usage: bench_root_parallel_strength [num_games] [num_iters] [num_threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+
+// Searches from the opening with every budget below 2 * num_threads; false on a failure
+static bool check_small_budgets(SearchConfig config){
+    bool ok = true;
+    for (int num_iters = SearchBudget::MIN_ITERS; num_iters < 2 * config.num_threads; num_iters++){
+        for (uint64_t seed = 0; seed < 20; seed++){
+            config.num_iters = num_iters;
+            config.seed = seed;
+            SearchTree<Game> tree(config);
+            Game game;
+            MCTSNode<Game> root = tree.search(game);
+            int best = root.best_child();
+            if (best == -1) {
+                printf("  %d iterations, seed %llu: no move, %d root visits\n", num_iters,
+                       static_cast<unsigned long long>(seed), root.n_visits());
+                ok = false;
+                continue;
+            }
+            // The main tree alone: its seed visit and fewer than num_iters backups
+            tree.advance(best);
+            if (!tree.root.is_null() && tree.root.n_visits() > num_iters) {
+                printf("  %d iterations, seed %llu: %d visits at the advanced root\n", num_iters,
+                       static_cast<unsigned long long>(seed), tree.root.n_visits());
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 20;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 1000;
+    int num_threads = argc > 3 ? atoi(argv[3]) : 4;
+
+    SearchConfig serial;
+    serial.num_iters = num_iters;
+
+    SearchConfig root_parallel;
+    root_parallel.num_iters = num_iters;
+    root_parallel.num_threads = num_threads;
+    root_parallel.mode = SearchMode::RootParallel;
+
+    bool small_ok = check_small_budgets(root_parallel);
+    printf("budgets below 2 iterations per thread: %s\n", small_ok ? "ok" : "FAILED");
+
+    auto start = std::chrono::steady_clock::now();
+    MatchResult result = play_match<Game>(root_parallel, serial, num_games);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("%d games, %d iters/move, root-parallel with %d threads vs serial\n", num_games, num_iters, num_threads);
+    result.print("root-parallel");
+    printf("elapsed %.1fs\n", elapsed.count());
+    return small_ok ? 0 : 1;
+}
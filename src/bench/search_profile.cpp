@@ -0,0 +1,88 @@
+// Per-phase search profile. Built with MCTS_PROFILE whatever the Makefile
+// says: the cycles one PhaseTimer adds, then the phase breakdown of one
+// search in each of serial UCT, serial PUCT, batched and tree-parallel
+// search from the same position, with the share of the search's wall time
+// (over all its threads) that the phases account for.
+//
+// Usage: bench_search_profile [num_iters] [num_threads]
+#ifndef MCTS_PROFILE
+#define MCTS_PROFILE
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+
+// Timer cycles per second, from the timer against steady_clock over 100 ms
+static double cycles_per_second(){
+    auto start = std::chrono::steady_clock::now();
+    uint64_t first = SearchProfile::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (SearchProfile::now() - first) / elapsed.count();
+}
+
+// Cycles one empty timed phase costs, timer included
+static double timer_cycles(int calls){
+    SearchProfile profile;
+    uint64_t start = SearchProfile::now();
+    {
+        ProfileScope scope(&profile);
+        for (int i = 0; i < calls; i++){
+            PhaseTimer timer(SearchPhase::Select);
+            asm volatile("" : : : "memory");
+        }
+    }
+    return static_cast<double>(SearchProfile::now() - start) / calls;
+}
+
+static void profile_search(const std::string& name, SearchConfig config, double rate){
+    Game game;
+    int opening[] = {3, 4, 4, 3};
+    for (int action : opening){
+        game.step(action);
+    }
+    SearchTree<Game> tree(config);
+    auto start = std::chrono::steady_clock::now();
+    tree.search(game);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const PhaseCounts& counts = tree.last_profile();
+    int threads = config.mode == SearchMode::Serial ? 1 : config.num_threads;
+    double covered = counts.total_cycles() / (elapsed.count() * rate * threads);
+    printf("\n%s: %d iterations in %.1f ms, phases cover %.0f%% of %d thread%s' time\n", name.c_str(),
+           config.num_iters, elapsed.count() * 1e3, covered * 100, threads, threads == 1 ? "" : "s");
+    counts.print(stdout, "  phases");
+}
+
+int main(int argc, char** argv){
+    int num_iters = argc > 1 ? atoi(argv[1]) : 50000;
+    int num_threads = argc > 2 ? atoi(argv[2]) : 4;
+
+    double rate = cycles_per_second();
+    printf("timer: %.2f GHz, %.1f cycles per timed phase\n", rate / 1e9, timer_cycles(10000000));
+
+    SearchConfig config;
+    config.num_iters = num_iters;
+    config.solver = false;
+    profile_search("serial UCT", config, rate);
+
+    SearchConfig puct = config;
+    puct.selection = SelectionRule::PUCT;
+    profile_search("serial PUCT", puct, rate);
+
+    SearchConfig batched = config;
+    batched.batch_size = 16;
+    profile_search("serial, batches of 16", batched, rate);
+
+    SearchConfig parallel = config;
+    parallel.mode = SearchMode::TreeParallel;
+    parallel.num_threads = num_threads;
+    profile_search("tree-parallel", parallel, rate);
+    return 0;
+}
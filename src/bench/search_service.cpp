@@ -0,0 +1,146 @@
+// SearchService on 8x8 Connect4, as a game server would drive it: the
+// latency of start(), stop() and apply_move(), the cost of a snapshot()
+// polled mid-search and what polling takes from the search rate, then
+// move requests served by one long-lived service against a fresh tree and
+// thread per request.
+//
+// Usage: bench_search_service [num_requests] [num_iters] [poll_ms]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "../search_service.hpp"
+
+using Game = Connect4<8>;
+using ActionIdxT = SearchService<Game>::ActionIdxT;
+using Clock = std::chrono::steady_clock;
+
+static double micros_since(Clock::time_point start){
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Iterations/sec of a search of seconds, snapshotting every poll seconds (0 for never)
+static double polled_rate(const SearchConfig& config, double seconds, double poll, double& snapshot_us){
+    SearchService<Game> service(config);
+    service.start(0, seconds);
+    int snapshots = 0;
+    double total_us = 0;
+    while (service.searching()){
+        if (poll > 0){
+            auto start = Clock::now();
+            service.snapshot();
+            total_us += micros_since(start);
+            snapshots++;
+            std::this_thread::sleep_for(std::chrono::duration<double>(poll));
+        } else {
+            service.wait();
+        }
+    }
+    snapshot_us = snapshots > 0 ? total_us / snapshots : 0;
+    return service.snapshot().iterations / seconds;
+}
+
+int main(int argc, char** argv){
+    int num_requests = argc > 1 ? atoi(argv[1]) : 30;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 2000;
+    double poll = (argc > 3 ? atof(argv[3]) : 1) / 1e3;
+
+    SearchConfig config;
+    MCTSNode<Game>::get_hf_net();
+
+    // Control latencies, stop() landing mid-search
+    {
+        SearchService<Game> service(config);
+        double start_us = 0, stop_us = 0, apply_us = 0;
+        for (int i = 0; i < num_requests; i++){
+            auto start = Clock::now();
+            service.start();
+            start_us += micros_since(start);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            start = Clock::now();
+            service.stop();
+            stop_us += micros_since(start);
+            ActionIdxT move = service.best_move();
+            start = Clock::now();
+            service.apply_move(move);
+            apply_us += micros_since(start);
+            Game game;
+            service.position(game);
+            if (game.is_terminal()){
+                game = Game();
+                service.set_position(game);
+            }
+        }
+        printf("start %.1f us  stop %.1f us  apply_move %.1f us\n", start_us / num_requests,
+               stop_us / num_requests, apply_us / num_requests);
+    }
+
+    double snapshot_us;
+    double quiet = polled_rate(config, 0.2, 0, snapshot_us);
+    double polled = polled_rate(config, 0.2, poll, snapshot_us);
+    printf("search %.0f iters/s, %.0f iters/s polled every %.1f ms (snapshot %.1f us)\n", quiet, polled,
+           poll * 1e3, snapshot_us);
+
+    // Move requests: search num_iters and play the best move, the client
+    // answering with a random reply; a finished game starts over
+    SearchConfig request = config;
+    request.num_iters = num_iters;
+    double service_ms = 0, fresh_ms = 0;
+    long long service_visits = 0, fresh_visits = 0;
+    {
+        SearchService<Game> service(request);
+        Rng rng;
+        Game game;
+        for (int i = 0; i < num_requests; i++){
+            auto start = Clock::now();
+            service.start(num_iters);
+            service.wait();
+            service_ms += micros_since(start) / 1e3;
+            SearchService<Game>::Snapshot snap = service.snapshot(1);
+            service_visits += snap.visits;
+            service.apply_move(snap.best_move);
+            game.step(snap.best_move);
+            if (!game.is_terminal()){
+                ActionIdxT reply = rng.below(game.num_actions);
+                service.apply_move(reply);
+                game.step(reply);
+            }
+            if (game.is_terminal()){
+                game = Game();
+                service.set_position(game);
+            }
+        }
+    }
+    {
+        Rng rng;
+        Game game;
+        for (int i = 0; i < num_requests; i++){
+            auto start = Clock::now();
+            ActionIdxT move;
+            std::thread thread([&]() {
+                SearchTree<Game> tree(request);
+                SearchBudget budget(request);
+                MCTSNode<Game> root = tree.search(game, budget);
+                fresh_visits += root.n_visits();
+                move = root.most_visited().second;
+            });
+            thread.join();
+            fresh_ms += micros_since(start) / 1e3;
+            game.step(move);
+            if (!game.is_terminal()){
+                game.step(rng.below(game.num_actions));
+            }
+            if (game.is_terminal()){
+                game = Game();
+            }
+        }
+    }
+    printf("%d requests of %d iters: service %.2f ms, %.0f root visits  fresh tree+thread %.2f ms, %.0f root visits\n",
+           num_requests, num_iters, service_ms / num_requests, static_cast<double>(service_visits) / num_requests,
+           fresh_ms / num_requests, static_cast<double>(fresh_visits) / num_requests);
+    return 0;
+}
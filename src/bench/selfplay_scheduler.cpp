@@ -0,0 +1,87 @@
+// Self-play scheduling: games of uneven length dealt round-robin to a fixed
+// thread each, as main() used to, against SelfPlayScheduler's work stealing.
+// The uneven games sleep for their length, so the comparison holds on any
+// number of cores; real 8x8 Connect4 self-play rates follow.
+//
+// Usage: bench_selfplay_scheduler [num_games] [threads] [search_games]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "../selfplay_scheduler.hpp"
+
+using Game = Connect4<8>;
+
+// Milliseconds game i lasts: mostly short, one in ten ten times longer
+static int game_ms(int64_t game){
+    Rng rng(Rng::stream_seed(Rng::DEFAULT_SEED, game));
+    return rng.below(10) == 0 ? 20 + rng.below(20) : 2 + rng.below(2);
+}
+
+static double round_robin(int num_games, int num_threads){
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++){
+        threads.emplace_back([t, num_games, num_threads]() {
+            for (int i = t; i < num_games; i += num_threads){
+                std::this_thread::sleep_for(std::chrono::milliseconds(game_ms(i)));
+            }
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// One self-play game at num_iters per move
+static void self_play(int64_t game, int num_iters){
+    SearchConfig config;
+    config.num_iters = num_iters;
+    config.seed = Rng::stream_seed(Rng::DEFAULT_SEED, game);
+    SearchTree<Game> tree(config);
+    Game state;
+    while (!state.is_terminal()){
+        int action = tree.search(state).dirichlet_select(tree.rng).second;
+        state.step(action);
+        tree.advance(action);
+    }
+}
+
+int main(int argc, char** argv){
+    int num_games = argc > 1 ? atoi(argv[1]) : 400;
+    int num_threads = argc > 2 ? atoi(argv[2]) : 8;
+    int search_games = argc > 3 ? atoi(argv[3]) : 16;
+
+    double total_ms = 0;
+    for (int i = 0; i < num_games; i++){
+        total_ms += game_ms(i);
+    }
+    printf("%d uneven games, %.0f ms of play over %d threads (ideal %.0f ms)\n", num_games, total_ms,
+           num_threads, total_ms / num_threads);
+    printf("  round-robin    %6.0f ms\n", round_robin(num_games, num_threads) * 1e3);
+    SchedulerConfig config;
+    config.num_games = num_games;
+    config.num_threads = num_threads;
+    SchedulerReport report = SelfPlayScheduler(config).run([](int64_t game, int) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(game_ms(game)));
+    });
+    printf("  work stealing  %6.0f ms  (%lld steals)\n", report.seconds * 1e3, static_cast<long long>(report.steals));
+
+    MCTSNode<Game>::get_hf_net();
+    SchedulerConfig search;
+    search.num_games = search_games;
+    for (bool pin : {false, true}){
+        search.pin_threads = pin;
+        SelfPlayScheduler scheduler(search);
+        SchedulerReport played = scheduler.run([](int64_t game, int) { self_play(game, 200); });
+        printf("self-play at 200 iters/move, %d threads, %d pinned: %.2f games/s\n", scheduler.threads(),
+               played.pinned, played.games_per_second());
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// MCTS-Solver on 8x8 Connect4 endgames: searches random positions some
+// plies in with and without the solver and reports how many roots it proves,
+// the iterations and time per search, then a match between the two at the
+// same num_iters.
+//
+// Usage: bench_solver [num_positions] [num_iters] [num_games]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+#include "match.hpp"
+
+using Game = Connect4<8>;
+
+// Positions plies random plies in that are not over
+static std::vector<Game> random_positions(int count, int plies, Rng& rng){
+    std::vector<Game> positions;
+    while (static_cast<int>(positions.size()) < count){
+        Game game;
+        game.step(rng.below(game.num_actions));
+        for (int i = 1; i < plies && !game.is_terminal(); i++){
+            game.step(rng.below(game.num_actions));
+        }
+        if (!game.is_terminal()) positions.push_back(game);
+    }
+    return positions;
+}
+
+static void run(const char* label, const SearchConfig& config, std::vector<Game>& positions){
+    long long iterations = 0;
+    int proven = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (Game& position : positions){
+        SearchTree<Game> tree(config);
+        SearchBudget budget(config);
+        proven += tree.search(position, budget).is_proven();
+        iterations += budget.iterations();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("  %-9s proven %5.1f%%  %7.0f iters/search  %7.2f ms/search\n", label,
+           100.0 * proven / positions.size(), static_cast<double>(iterations) / positions.size(),
+           elapsed.count() / positions.size() * 1e3);
+}
+
+int main(int argc, char** argv){
+    int num_positions = argc > 1 ? atoi(argv[1]) : 100;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 10000;
+    int num_games = argc > 3 ? atoi(argv[3]) : 40;
+
+    SearchConfig solver;
+    solver.num_iters = num_iters;
+    solver.reuse_tree = false;
+
+    SearchConfig plain = solver;
+    plain.solver = false;
+
+    MCTSNode<Game>::get_hf_net();
+    Rng rng;
+    for (int plies : {24, 32, 40, 46}){
+        std::vector<Game> positions = random_positions(num_positions, plies, rng);
+        printf("%d positions %d plies in, %d iters/search\n", num_positions, plies, num_iters);
+        run("solver", solver, positions);
+        run("no solver", plain, positions);
+    }
+
+    solver.reuse_tree = plain.reuse_tree = true;
+    solver.num_iters = plain.num_iters = num_iters / 5;
+    auto start = std::chrono::steady_clock::now();
+    MatchResult result = play_match<Game>(solver, plain, num_games);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%d games, %d iters/move, solver vs no solver\n", num_games, solver.num_iters);
+    result.print("solver");
+    printf("elapsed %.1fs\n", elapsed.count());
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Subtree reuse on 8x8 Connect4: self-play games where the played move's
+// subtree becomes the next root. Reports how many visits each search
+// inherits, i.e. iterations that did not have to be spent again.
+//
+// Usage: bench_subtree_reuse [num_games] [num_iters]
+#include <cstdio>
+#include <cstdlib>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+int main(int argc, char** argv){
+    using Game = Connect4<8>;
+    int num_games = argc > 1 ? atoi(argv[1]) : 10;
+    int num_iters = argc > 2 ? atoi(argv[2]) : 1000;
+
+    SearchConfig config;
+    config.num_iters = num_iters;
+
+    long long total_reused = 0;
+    long long total_searched = 0;
+    int total_plies = 0;
+    for (int g = 0; g < num_games; g++){
+        Game game;
+        config.seed = Rng::stream_seed(Rng::DEFAULT_SEED, g);
+        SearchTree<Game> tree(config);
+        long long reused = 0;
+        int plies = 0;
+        while (!game.is_terminal()){
+            if (!tree.root.is_null()){
+                reused += tree.root.n_visits();
+            }
+            int action = tree.search(game).dirichlet_select(tree.rng).second;
+            game.step(action);
+            tree.advance(action);
+            plies++;
+        }
+        printf("game %2d: %2d plies, %7lld visits reused (%.1f per ply)\n", g, plies, reused, double(reused) / plies);
+        total_reused += reused;
+        total_searched += (long long)plies * num_iters;
+        total_plies += plies;
+    }
+    printf("average %.0f visits reused per game, %.1f per ply, %.1f%% of %d iters/move\n",
+           double(total_reused) / num_games, double(total_reused) / total_plies,
+           100.0 * total_reused / total_searched, num_iters);
+    return 0;
+}
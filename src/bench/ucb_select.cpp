@@ -0,0 +1,80 @@
+// Selection throughput: ucb_select calls/sec over the fully expanded nodes of
+// a searched 8x8 Connect4 tree, visited in random order so most calls miss the
+// cache, and on a single hot node for comparison. Every call scores a node's
+// whole children block; only nodes whose children all have visits are used,
+// so the choice rests on real statistics rather than an unvisited child's INF.
+//
+// Usage: bench_ucb_select [tree_iters] [rounds]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+using SearchNode = MCTSNode<Game>;
+
+// Selects once on every node, then takes the virtual loss back off so the tree
+// is unchanged for the next round. Returns selections per second.
+static double select_rate(const std::vector<SearchNode>& nodes, int rounds, long& checksum){
+    NodeArena& arena = *SearchNode::get_arena();
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++){
+        for (SearchNode node : nodes){
+            NodeId block = node.children();
+            int action = node.ucb_select(block);
+            arena.virtual_loss[block + action].fetch_sub(1, std::memory_order_relaxed);
+            checksum += action;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(nodes.size()) * rounds / elapsed.count();
+}
+
+// Adds node and every node below it whose children have all been visited
+static void collect_full(SearchNode node, std::vector<SearchNode>& full){
+    NodeId block = node.children();
+    if (block == NULL_NODE) return;
+    bool all_visited = true;
+    for (int i = 0; i < node.num_actions(); i++){
+        SearchNode child = node.child(i);
+        all_visited = all_visited && child.n_visits() > 0;
+        collect_full(child, full);
+    }
+    if (all_visited) full.push_back(node);
+}
+
+int main(int argc, char** argv){
+    int tree_iters = argc > 1 ? atoi(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+    Game game;
+    int opening[] = {3, 4, 4, 3, 2, 5, 5, 2};
+    for (int action : opening){
+        game.step(action);
+    }
+
+    SearchNode root = SearchNode::new_root(game.get_prev_player());
+    root.traverse(tree_iters, game);
+
+    std::vector<SearchNode> nodes;
+    collect_full(root, nodes);
+    std::shuffle(nodes.begin(), nodes.end(), std::mt19937(1));
+
+    long checksum = 0;
+    double cold = select_rate(nodes, rounds, checksum);
+    std::vector<SearchNode> hot(nodes.size(), root);
+    double warm = select_rate(hot, rounds, checksum);
+
+    printf("node size %zu bytes, %zu fully expanded nodes, %zu blocks of %d in use\n", NodeArena::BYTES_PER_NODE,
+           nodes.size(), SearchNode::get_arena()->blocks_in_use(), SearchNode::get_arena()->get_block_size());
+    printf("random nodes %12.0f selects/s  %6.1f ns/select\n", cold, 1e9 / cold);
+    printf("root only    %12.0f selects/s  %6.1f ns/select\n", warm, 1e9 / warm);
+    printf("checksum %ld\n", checksum);
+    root.delete_rec();
+    return 0;
+}
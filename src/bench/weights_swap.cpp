@@ -0,0 +1,100 @@
+// Hot-swapping HF_Net weights. First the cost of finding the evaluator,
+// with and without a pin; then self-play games on several threads, each
+// game under one pin, while the main thread publishes a new net every few
+// milliseconds. Every move checks that the search saw the game's own
+// generation, the publish latency is timed, and every retired net must be
+// freed once the games that used it are over.
+//
+// Usage: bench_weights_swap [seconds] [threads] [swap_ms]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../mcts.hpp"
+
+using Game = Connect4<8>;
+using Net = MCTSNode<Game>::Net;
+
+// ns per get_hf_net() call
+static double lookup_ns(long calls){
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (long i = 0; i < calls; i++){
+        sum += MCTSNode<Game>::get_hf_net()->generation;
+        asm volatile("" : : "r"(sum));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9 / calls;
+}
+
+int main(int argc, char** argv){
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int num_threads = argc > 2 ? atoi(argv[2]) : 4;
+    int swap_ms = argc > 3 ? atoi(argv[3]) : 5;
+
+    MCTSNode<Game>::get_hf_net();
+    printf("get_hf_net: unpinned %.1f ns", lookup_ns(2000000));
+    {
+        MCTSNode<Game>::NetPin pin;
+        printf(", pinned %.1f ns\n", lookup_ns(20000000));
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<long> games{0}, moves{0}, mismatches{0};
+    std::vector<std::thread> players;
+    for (int t = 0; t < num_threads; t++){
+        players.emplace_back([&, t]() {
+            for (int64_t game_index = t; !done; game_index += num_threads){
+                MCTSNode<Game>::NetPin pin;
+                uint64_t generation = pin.get()->generation;
+                SearchConfig config;
+                config.num_iters = 100;
+                config.seed = Rng::stream_seed(Rng::DEFAULT_SEED, game_index);
+                SearchTree<Game> tree(config);
+                Game game;
+                while (!game.is_terminal()){
+                    int action = tree.search(game).most_visited().second;
+                    mismatches += MCTSNode<Game>::get_hf_net()->generation != generation;
+                    moves++;
+                    game.step(action);
+                    tree.advance(action);
+                }
+                games++;
+            }
+        });
+    }
+
+    std::vector<std::weak_ptr<Net>> retired;
+    double worst_publish_us = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t generation = 1; std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds); generation++){
+        std::this_thread::sleep_for(std::chrono::milliseconds(swap_ms));
+        auto net = std::make_shared<Net>();
+        net->generation = generation;
+        net->weights[0] += 1e-3 * generation;
+        retired.push_back(MCTSNode<Game>::current_hf_net());
+        auto publish = std::chrono::steady_clock::now();
+        MCTSNode<Game>::set_hf_net(net);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - publish;
+        worst_publish_us = std::max(worst_publish_us, elapsed.count() * 1e6);
+    }
+    done = true;
+    for (auto& player : players){
+        player.join();
+    }
+
+    long alive = 0;
+    for (auto& net : retired){
+        alive += !net.expired();
+    }
+    printf("%zu swaps over %.1fs, %ld games, %ld moves on %d threads\n", retired.size(), seconds, games.load(),
+           moves.load(), num_threads);
+    printf("moves that saw another generation than their game: %ld\n", mismatches.load());
+    printf("worst publish %.1f us, retired nets still alive after the games: %ld\n", worst_publish_us, alive);
+    return mismatches == 0 && alive == 0 ? 0 : 1;
+}
@@ -6,7 +6,9 @@
 #include <array>
 #include <cstring> // For memcpy
 #include <iostream>
+#include <fstream>
 #include <cassert>
+#include <cstdint>
 
 #define round_up(x, y) (((x) + (y) - 1) / (y))
 
@@ -24,10 +26,31 @@ public:
         Player1 = 1
     };
     PlayerType player;
+    constexpr static int MAX_ACTIONS = BOARD_SIZE; // Upper bound on num_actions
     int num_actions;
     int col_heights[BOARD_SIZE];
     ActionT action_map[BOARD_SIZE];
     int last_row[2], last_col[2]; // Track last move for optimization
+    uint64_t hash; // Zobrist hash of the stones on the board, updated in step
+
+    // One random key per (player, col, row); splitmix64 keeps them reproducible
+    struct ZobristKeys {
+        uint64_t keys[2][BOARD_SIZE][BOARD_SIZE];
+        ZobristKeys() {
+            uint64_t seed = 0x9E3779B97F4A7C15ULL;
+            for (int p = 0; p < 2; p++) {
+                for (int col = 0; col < BOARD_SIZE; col++) {
+                    for (int row = 0; row < BOARD_SIZE; row++) {
+                        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+                        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                        keys[p][col][row] = z ^ (z >> 31);
+                    }
+                }
+            }
+        }
+    };
+    static inline const ZobristKeys zobrist{};
 
     inline PlayerType get_next_player() {
         return PlayerType(player ^ 1);
@@ -49,6 +72,12 @@ public:
         }
         player = Player0;
         num_actions = BOARD_SIZE;
+        hash = 0;
+        // No moves yet, so is_winner has nothing to check
+        for (int i = 0; i < 2; i++) {
+            last_row[i] = -1;
+            last_col[i] = -1;
+        }
     }
 
     void copy_to(Connect4& copy_game){     
@@ -64,6 +93,7 @@ public:
         // Copy other members
         copy_game.player = this->player;
         copy_game.num_actions = this->num_actions;
+        copy_game.hash = this->hash;
         for (int i = 0; i < 2; i++) {
             copy_game.last_row[i] = this->last_row[i];
             copy_game.last_col[i] = this->last_col[i];
@@ -75,10 +105,13 @@ public:
         int col = action_map[action_idx];
         int row = col_heights[col]++;
         state[player][col][row / BOARD_REP_SIZE] |= (static_cast<BoardRepT>(1) << (row % BOARD_REP_SIZE));
+        hash ^= zobrist.keys[player][col][row];
         
+        // Remove the full column in order, so action indices depend only on the
+        // position and not on the move order that reached it
         if(col_heights[col] >= BOARD_SIZE){
-            if(action_idx != num_actions - 1){
-                action_map[action_idx] = action_map[num_actions - 1];
+            for (int i = action_idx; i < num_actions - 1; i++){
+                action_map[i] = action_map[i + 1];
             }
             num_actions--;
         }
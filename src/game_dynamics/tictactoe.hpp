@@ -17,6 +17,7 @@ public:
     };
     int state[3][3];
     PlayerType player;
+    constexpr static int MAX_ACTIONS = 9; // Upper bound on num_actions
     int num_actions;
     std::vector<ActionT> action_map;
 
@@ -117,13 +118,13 @@ public:
     }
 };
 
-TicTacToe::RewardT& operator +=(TicTacToe::RewardT& lhs, const TicTacToe::RewardT& rhs) {
+inline TicTacToe::RewardT& operator +=(TicTacToe::RewardT& lhs, const TicTacToe::RewardT& rhs) {
     lhs[0] += rhs[0];
     lhs[1] += rhs[1];
     return lhs;
 }
 
-TicTacToe::RewardT operator /(const TicTacToe::RewardT& lhs, int rhs) {
+inline TicTacToe::RewardT operator /(const TicTacToe::RewardT& lhs, int rhs) {
     return TicTacToe::RewardT{lhs[0] / rhs, lhs[1] / rhs};
 }
 
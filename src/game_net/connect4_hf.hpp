@@ -2,6 +2,11 @@
 #define CONNECT4_HF_HPP
 #include "../game_dynamics/connect4.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
 
 template<int BOARD_SIZE>
 class HF_Net{
@@ -10,6 +15,7 @@ class HF_Net{
     using PlayerType = typename Game::PlayerType;
     public:
     constexpr static int NUM_FEATURES = 15;
+    constexpr static int MAX_BATCH = 64;
     double weights[NUM_FEATURES] = {
         0.00529924,
         0.03955487,
@@ -60,12 +66,96 @@ class HF_Net{
         return RewardT{reward, -reward};
     }
 
+    // Batched evaluation of count positions, same results as calling forward on
+    // each. Features are extracted feature-major so each feature function is
+    // dispatched once per chunk and the weighted sum is a vectorizable loop over
+    // the batch. Any evaluator plugged into MCTSNode provides this signature.
+    void forward_batch(const Game* games, int count, RewardT* out) {
+        for (int start = 0; start < count; start += MAX_BATCH) {
+            int n = std::min(MAX_BATCH, count - start);
+            double reward[MAX_BATCH] = {0.0};
+            double values[MAX_BATCH];
+
+            for (int i = 0; i < NUM_FEATURES; i++) {
+                auto feature = fptr[i];
+                for (int b = 0; b < n; b++) {
+                    values[b] = (this->*feature)(games[start + b]);
+                }
+                double weight = weights[i];
+                for (int b = 0; b < n; b++) {
+                    reward[b] += values[b] * weight;
+                }
+            }
+
+            for (int b = 0; b < n; b++) {
+                double squashed = std::tanh(reward[b]);
+                out[start + b] = RewardT{squashed, -squashed};
+            }
+        }
+    }
+
     void fill_evals(const Game& game, double* arr){
         for(int i = 0; i < NUM_FEATURES; i++){
             arr[i] = (this->*fptr[i])(game);
         }
     }
 
+    // Weights files, as written by bin/fit_weights: a line
+    // "hf_net_weights <WEIGHTS_VERSION> <NUM_FEATURES> <generation>", then one
+    // weight per line. Version 1 files have no generation and load as 0.
+    constexpr static const char* WEIGHTS_MAGIC = "hf_net_weights";
+    constexpr static int WEIGHTS_VERSION = 2;
+
+    // Counts refits: each file fit_weights writes is one past the last
+    uint64_t generation = 0;
+
+    // Replaces the weights with the file's; throws std::runtime_error, leaving
+    // them unchanged, if it cannot be read or is for another version or size
+    void load_weights(const std::string& path){
+        std::ifstream file(path);
+        std::string magic;
+        int version = 0, count = 0;
+        uint64_t loaded_generation = 0;
+        if (!(file >> magic >> version >> count)) {
+            throw std::runtime_error(path + ": cannot read weights");
+        }
+        if (magic != WEIGHTS_MAGIC || version < 1 || version > WEIGHTS_VERSION || count != NUM_FEATURES) {
+            throw std::runtime_error(path + ": not version " + std::to_string(WEIGHTS_VERSION) +
+                                     " weights for " + std::to_string(NUM_FEATURES) + " features");
+        }
+        if (version >= 2 && !(file >> loaded_generation)) {
+            throw std::runtime_error(path + ": cannot read weights");
+        }
+        double loaded[NUM_FEATURES];
+        for (int i = 0; i < NUM_FEATURES; i++){
+            if (!(file >> loaded[i])) {
+                throw std::runtime_error(path + ": truncated weights");
+            }
+        }
+        std::copy(loaded, loaded + NUM_FEATURES, weights);
+        generation = loaded_generation;
+    }
+
+    // Writes the weights to a temporary file renamed over path, so a reader
+    // sees either the old file or the whole new one
+    void save_weights(const std::string& path) const {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary);
+            file.precision(17);
+            file << WEIGHTS_MAGIC << " " << WEIGHTS_VERSION << " " << NUM_FEATURES << " " << generation << "\n";
+            for (int i = 0; i < NUM_FEATURES; i++){
+                file << weights[i] << "\n";
+            }
+            if (!file.flush()) {
+                throw std::runtime_error(temporary + ": cannot write weights");
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error(path + ": cannot replace weights");
+        }
+    }
+
     double open3_helper(const Game& game, PlayerType check_player, int row, int col) {
         double open3 = 0.0;
         PlayerType other_player = PlayerType(check_player ^ 1);
@@ -0,0 +1,1583 @@
+#ifndef MCTS_HPP
+#define MCTS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <cassert>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <unordered_set>
+
+// Game headers; tictactoe.hpp also provides the RewardT arithmetic operators
+#include "game_dynamics/tictactoe.hpp"
+#include "game_dynamics/connect4.hpp"
+
+#include "node_arena.hpp"
+#include "playout_kernel.hpp"
+#include "rng.hpp"
+#include "search_profile.hpp"
+#include "transposition_table.hpp"
+
+#include "game_net/connect4_hf.hpp"
+
+#if defined(__AVX2__) && !defined(__SANITIZE_THREAD__)
+#include <immintrin.h>
+#endif
+
+#define NUM_ROLLOUTS 10
+
+// Relaxed fetch_add for atomic floating point (std::atomic<double>::fetch_add is C++20)
+template <typename T>
+inline void atomic_add(std::atomic<T>& target, T value){
+    T current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed));
+}
+
+enum class SearchMode {
+    Serial,       // One thread, one tree
+    TreeParallel, // num_threads workers share one tree (virtual loss)
+    RootParallel  // num_threads private trees, root statistics merged at the end
+};
+
+enum class SelectionRule {
+    UCT, // UCB1 over the children; unvisited children are tried first, in order
+    PUCT // Q plus an exploration term weighted by each child's prior from the Net
+};
+
+// Per-search settings; num_iters is the total across all threads
+struct SearchConfig {
+    int num_iters = 1000; // 0 for no limit, given a time_limit
+    double time_limit = 0; // Seconds per search, 0 for none; the search stops at whichever limit comes first
+    int num_threads = 1;
+    int batch_size = 1; // Leaves selected per batched Net evaluation
+    bool reuse_tree = true; // Keep the played move's subtree for the next search
+    bool use_transpositions = true; // Share nodes between move orders (DAG)
+    size_t max_nodes = 0; // Node budget for the shared tree, 0 for none; least-visited subtrees are pruned to fit
+    // Stop once the most visited root move can no longer be overtaken in the iterations left
+    bool early_stop = false;
+    // Also stop once the most visited root move's Q leads every other by this many
+    // standard errors, 0 for off. Neither stop applies to RootParallel.
+    double stop_confidence = 0;
+    // Seeds the search's random streams; with a fixed seed a serial search
+    // replays exactly. Parallel searches still vary with thread timing.
+    uint64_t seed = Rng::DEFAULT_SEED;
+    SelectionRule selection = SelectionRule::UCT;
+    RolloutPolicy rollout = RolloutPolicy::Tactical;
+    // MCTS-Solver: terminal results are proven and propagated up the tree,
+    // selection skips proven losses and the search stops once the root is proven
+    bool solver = true;
+    SearchMode mode = SearchMode::Serial;
+};
+
+// The iterations a search may still run: up to a count across all threads
+// and until a deadline, whichever ends first. Threads draw iterations from it
+// as they go, so a search can end between any two iterations with every
+// finished playout already in the tree. stop() ends it from any thread.
+// A budget made with a parent also draws from the parent, which bounds a
+// slice of a longer search and still answers to its deadline and stop().
+class SearchBudget {
+    public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int64_t UNLIMITED = std::numeric_limits<int64_t>::max();
+    // Handed out whatever the deadline, enough to expand a fresh root and
+    // visit one child, so a search always leaves a move to play
+    static constexpr int64_t MIN_ITERS = 2;
+
+    explicit SearchBudget(int64_t num_iters, Clock::time_point deadline = Clock::time_point::max())
+        : limit(num_iters), deadline(deadline), parent(nullptr) {}
+
+    SearchBudget(int64_t num_iters, SearchBudget& parent)
+        : limit(num_iters), deadline(Clock::time_point::max()), parent(&parent) {}
+
+    explicit SearchBudget(const SearchConfig& config)
+        : SearchBudget(config.num_iters > 0 ? config.num_iters : (config.time_limit > 0 ? UNLIMITED : 0),
+                       config.time_limit > 0 ? after(config.time_limit) : Clock::time_point::max()) {}
+
+    SearchBudget(const SearchBudget&) = delete;
+    SearchBudget& operator=(const SearchBudget&) = delete;
+
+    static Clock::time_point after(double seconds){
+        return Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    // check runs on one claiming thread about every interval iterations with
+    // the iterations still left; once it returns true the budget is spent
+    void set_stop_check(std::function<bool(int64_t)> check, int64_t interval){
+        stop_check = std::move(check);
+        check_interval = interval;
+        next_check.store(claimed.load(std::memory_order_relaxed) + interval, std::memory_order_relaxed);
+    }
+
+    // Up to count iterations for the caller to run; 0 once the budget is
+    // spent. Reads the clock only when there is a deadline.
+    int claim(int count){
+        if (stopped.load(std::memory_order_relaxed)) return 0;
+        if (past_deadline()){
+            stopped.store(true, std::memory_order_relaxed);
+            return 0;
+        }
+        if (stop_check){
+            int64_t due = next_check.load(std::memory_order_relaxed);
+            if (claimed.load(std::memory_order_relaxed) >= due
+                && next_check.compare_exchange_strong(due, due + check_interval, std::memory_order_relaxed)
+                && stop_check(remaining())){
+                decided.store(true, std::memory_order_relaxed);
+                stopped.store(true, std::memory_order_relaxed);
+                return 0;
+            }
+        }
+        int64_t first = claimed.fetch_add(count, std::memory_order_relaxed);
+        if (first >= limit) return 0;
+        int granted = static_cast<int>(std::min<int64_t>(count, limit - first));
+        return parent != nullptr ? parent->claim(granted) : granted;
+    }
+
+    void stop(){
+        stopped.store(true, std::memory_order_relaxed);
+    }
+
+    bool exhausted() const {
+        return stopped.load(std::memory_order_relaxed) || remaining() == 0 || past_deadline()
+            || (parent != nullptr && parent->exhausted());
+    }
+
+    // Iterations handed out so far
+    int64_t iterations() const {
+        return std::min(claimed.load(std::memory_order_relaxed), limit);
+    }
+
+    int64_t remaining() const {
+        return limit - iterations();
+    }
+
+    // True if the stop check ended the search
+    bool stopped_early() const {
+        return decided.load(std::memory_order_relaxed);
+    }
+
+    private:
+    const int64_t limit;
+    const Clock::time_point deadline;
+    SearchBudget* const parent;
+    std::atomic<int64_t> claimed{0};
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> decided{false};
+    std::function<bool(int64_t)> stop_check;
+    int64_t check_interval = 0;
+    std::atomic<int64_t> next_check{0};
+
+    bool past_deadline() const {
+        return deadline != Clock::time_point::max() && claimed.load(std::memory_order_relaxed) >= MIN_ITERS
+            && Clock::now() >= deadline;
+    }
+};
+
+// A search running on a thread of its own. start() hands the thread a fresh
+// budget and stop() ends that budget and waits for the thread, so the tree
+// it searched is left whole, every finished playout in it, for the caller
+// to read, advance or search again.
+class SearchHandle {
+    public:
+    SearchHandle() = default;
+    SearchHandle(const SearchHandle&) = delete;
+    SearchHandle& operator=(const SearchHandle&) = delete;
+
+    ~SearchHandle(){
+        stop();
+    }
+
+    // Runs search(budget) on a new thread within num_iters and deadline,
+    // after stopping any search still running
+    template <typename Search>
+    void start(Search search, int64_t num_iters = SearchBudget::UNLIMITED,
+               SearchBudget::Clock::time_point deadline = SearchBudget::Clock::time_point::max()){
+        stop();
+        budget = std::make_unique<SearchBudget>(num_iters, deadline);
+        SearchBudget* running = budget.get();
+        thread = std::thread([search, running]() mutable { search(*running); });
+    }
+
+    // Ends the search and waits for it; returns the iterations it ran, 0 if
+    // none was running
+    int64_t stop(){
+        if (!thread.joinable()) return 0;
+        budget->stop();
+        thread.join();
+        return budget->iterations();
+    }
+
+    // True from start() until stop(), even once the budget is spent
+    bool active() const {
+        return thread.joinable();
+    }
+
+    // Iterations of the current or last search so far
+    int64_t iterations() const {
+        return budget ? budget->iterations() : 0;
+    }
+
+    private:
+    std::unique_ptr<SearchBudget> budget;
+    std::thread thread;
+};
+
+// Handle to one node in the shared NodeArena. A node's statistics describe
+// the move into it, so they double as the parent's edge statistics; all
+// children of a node sit in one block of the arena. Handles are plain 32-bit
+// ids and are passed by value.
+template <typename Game>
+class MCTSNode {
+    constexpr static float INF = 1e6;
+    // Each in-flight descent counts as this many lost playouts until it is backed up
+    constexpr static int VIRTUAL_LOSS = 1;
+    constexpr static int MAX_BATCH = 64;
+    // Children are scored eight floats at a time, so blocks are padded to match
+    constexpr static int SIMD_WIDTH = 8;
+    // Floor on the per-visit reward variance assumed by confident()
+    constexpr static double MIN_VARIANCE = 0.05;
+    // PUCT: exploration weight, softmax temperature over the children's Net
+    // values, and how far below the parent's value an unvisited child starts
+    constexpr static float C_PUCT = 1.5f;
+    constexpr static float PRIOR_TEMPERATURE = 0.2f;
+    constexpr static float FPU_REDUCTION = 0.2f;
+    public:
+    constexpr static int MAX_CHILDREN = (Game::MAX_ACTIONS + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    // Address space only, halved by the arena where that much cannot be
+    // reserved; memory is committed as the tree grows into it
+    constexpr static size_t NODE_CAPACITY = size_t(1) << 30;
+
+    using ActionT = typename Game::ActionT;
+    using ActionIdxT = int;
+    using RewardT = typename Game::RewardT;
+    using PlayerType = typename Game::PlayerType;
+
+    using Net = HF_Net<8>;
+
+    // Keyed by position, holding the children block shared by every node for it
+    using TT = TranspositionTable<NodeId>;
+    using Path = std::vector<MCTSNode<Game>>;
+
+    // Per-thread scratch for iterate/iterate_batch: leaf positions, the
+    // paths that reached them, and the thread's random stream
+    struct Scratch {
+        std::vector<Game> states;
+        std::vector<Path> paths;
+        Rng rng;
+        Scratch(int size, Rng rng) : states(size), paths(size), rng(rng) {}
+    };
+
+    // What a root-parallel search folded into the root from its helper
+    // trees: the root's own visits and value, then each child's. The root's
+    // children keep their subtrees from the main tree, so a caller going on
+    // to reuse the tree takes these back out first (unmerge).
+    struct RootMerge {
+        int visits = 0;
+        float W = 0;
+        std::vector<int> child_visits;
+        std::vector<float> child_W;
+    };
+
+    NodeId id;
+
+    MCTSNode() : id(NULL_NODE) {}
+    explicit MCTSNode(NodeId id) : id(id) {}
+
+    bool is_null() const { return id == NULL_NODE; }
+    bool operator==(const MCTSNode<Game>& other) const { return id == other.id; }
+    bool operator!=(const MCTSNode<Game>& other) const { return id != other.id; }
+
+    static std::atomic<NodeArena*> arena;
+    static std::shared_ptr<Net> hf_net; // Only through std::atomic_load/atomic_store
+    static std::mutex init_mutex;
+    static thread_local const std::shared_ptr<Net>* pinned_hf_net;
+
+    // Static method to get/initialize the node arena
+    static NodeArena* get_arena() {
+        NodeArena* nodes = arena.load(std::memory_order_acquire);
+        if (nodes == nullptr) {
+            std::lock_guard<std::mutex> lock(init_mutex);
+            nodes = arena.load(std::memory_order_relaxed);
+            if (nodes == nullptr) {
+                nodes = new NodeArena(NODE_CAPACITY, MAX_CHILDREN);
+                arena.store(nodes, std::memory_order_release);
+            }
+        }
+        return nodes;
+    }
+
+    // The published evaluator. Searches never see a change mid-search: each
+    // one holds a NetPin, and a net is freed only when its last pin is gone.
+    static std::shared_ptr<Net> current_hf_net() {
+        std::shared_ptr<Net> net = std::atomic_load(&hf_net);
+        if (!net) {
+            std::lock_guard<std::mutex> lock(init_mutex);
+            net = std::atomic_load(&hf_net);
+            if (!net) {
+                net = std::make_shared<Net>();
+                std::atomic_store(&hf_net, net);
+            }
+        }
+        return net;
+    }
+
+    // Publishes net for searches that start from now on; running ones, and
+    // games holding a pin, finish on the net they started with. net must not
+    // change once published.
+    static void set_hf_net(std::shared_ptr<Net> net) {
+        std::atomic_store(&hf_net, std::move(net));
+    }
+
+    // The net pinned by this thread, else the published one, which outside a
+    // pin is only good until the next set_hf_net
+    static Net* get_hf_net() {
+        if (pinned_hf_net != nullptr) {
+            return pinned_hf_net->get();
+        }
+        return current_hf_net().get();
+    }
+
+    // Holds one net as this thread's evaluator for its lifetime: the published
+    // one, or a given one to share another thread's. Pins nest; an inner one
+    // keeps the outer one's net.
+    class NetPin {
+        public:
+        NetPin() : NetPin(pinned_hf_net != nullptr ? *pinned_hf_net : current_hf_net()) {}
+
+        explicit NetPin(std::shared_ptr<Net> pinned) : net(std::move(pinned)) {
+            if (pinned_hf_net == nullptr) {
+                pinned_hf_net = &net;
+                outermost = true;
+            }
+        }
+
+        ~NetPin(){
+            if (outermost) pinned_hf_net = nullptr;
+        }
+
+        NetPin(const NetPin&) = delete;
+        NetPin& operator=(const NetPin&) = delete;
+
+        const std::shared_ptr<Net>& get() const {
+            return *pinned_hf_net;
+        }
+
+        private:
+        std::shared_ptr<Net> net;
+        bool outermost = false;
+    };
+
+    __attribute__((always_inline)) static RewardT net_rollout(Game& game_state){
+        PhaseTimer timer(SearchPhase::Evaluate);
+        return get_hf_net()->forward(game_state);
+    }
+
+    // Net values of count positions in one forward_batch call
+    __attribute__((always_inline)) static void net_rollouts(const Game* positions, int count, RewardT* values){
+        PhaseTimer timer(SearchPhase::Evaluate);
+        get_hf_net()->forward_batch(positions, count, values);
+    }
+
+    static RewardT random_rollouts(Game& game_state, int num_rollouts, Rng& rng, RolloutPolicy policy){
+        RewardT reward;
+        random_rollouts(&game_state, 1, num_rollouts, rng, &reward, policy);
+        return reward;
+    }
+
+    // Mean reward of num_rollouts playouts under policy from each of count
+    // positions, through the game's PlayoutKernel when it has one
+    static void random_rollouts(Game* positions, int count, int num_rollouts, Rng& rng, RewardT* rewards,
+                                RolloutPolicy policy){
+        PhaseTimer timer(SearchPhase::Rollout);
+        if constexpr (PlayoutKernel<Game>::available) {
+            PlayoutKernel<Game>::play(positions, count, num_rollouts, rng, rewards, policy);
+        } else {
+            Game rollout;
+            for (int j = 0; j < count; j++){
+                RewardT total_reward = {0, 0};
+                for (int i = 0; i < num_rollouts; i++){
+                    positions[j].copy_to(rollout);
+                    while (!rollout.is_terminal()){
+                        ActionIdxT action_idx = policy == RolloutPolicy::Tactical ? tactical_policy(rollout, rng)
+                                                                                  : random_policy(rollout, rng);
+                        rollout.step(action_idx);
+                    }
+                    total_reward += rollout.get_reward();
+                }
+                rewards[j] = total_reward / num_rollouts;
+            }
+        }
+    }
+
+    static ActionIdxT random_policy(Game& game_state, Rng& rng){
+        return rng.below(game_state.num_actions);
+    }
+
+    // RolloutPolicy::Tactical for games without a PlayoutKernel, by trying
+    // moves on copies: a move that wins at once, else a uniform pick among
+    // the moves that leave the opponent no immediate win, else any move
+    static ActionIdxT tactical_policy(Game& game_state, Rng& rng){
+        PlayerType mover = game_state.player;
+        ActionIdxT safe[Game::MAX_ACTIONS];
+        int num_safe = 0;
+        Game after, reply;
+        for (ActionIdxT i = 0; i < game_state.num_actions; i++){
+            game_state.copy_to(after);
+            after.step(i);
+            if (after.is_terminal()) {
+                if (after.get_reward()[mover] > 0) return i;
+                safe[num_safe++] = i;
+                continue;
+            }
+            bool loses = false;
+            for (ActionIdxT j = 0; j < after.num_actions && !loses; j++){
+                after.copy_to(reply);
+                reply.step(j);
+                loses = reply.is_terminal() && reply.get_reward()[mover] < 0;
+            }
+            if (!loses) safe[num_safe++] = i;
+        }
+        if (num_safe == 0) return random_policy(game_state, rng);
+        return safe[rng.below(num_safe)];
+    }
+
+    int n_visits() const {
+        return get_arena()->visits[id].load(std::memory_order_relaxed);
+    }
+
+    double get_Q() const {
+        NodeArena& nodes = *get_arena();
+        int n = nodes.visits[id].load(std::memory_order_relaxed);
+        return n == 0 ? 0.0 : nodes.W[id].load(std::memory_order_relaxed) / n;
+    }
+
+    // Player who made the move leading to this node
+    PlayerType player() const {
+        return PlayerType(get_arena()->flags[id].load(std::memory_order_relaxed) & NodeArena::PLAYER1);
+    }
+
+    bool is_expanded() const {
+        return get_arena()->flags[id].load(std::memory_order_acquire) & NodeArena::EXPANDED;
+    }
+
+    bool is_proven() const {
+        return get_arena()->flags[id].load(std::memory_order_relaxed) & NodeArena::PROVEN;
+    }
+
+    // Expanded and not proven: a descent selects through it. A proven
+    // node's value is known, so descents end there.
+    bool is_selectable() const {
+        uint8_t flags = get_arena()->flags[id].load(std::memory_order_acquire);
+        return (flags & (NodeArena::EXPANDED | NodeArena::PROVEN)) == NodeArena::EXPANDED;
+    }
+
+    // The exact result of a proven node, to back up in place of a playout
+    RewardT proven_reward() const {
+        double value = get_arena()->flags[id].load(std::memory_order_relaxed) & NodeArena::PROVEN_WIN ? 1.0 : -1.0;
+        RewardT reward;
+        reward[player()] = value;
+        reward[player() ^ 1] = -value;
+        return reward;
+    }
+
+    int num_actions() const {
+        return get_arena()->num_children[id];
+    }
+
+    // First id of the children block, NULL_NODE until a descent first selects
+    // from this node
+    NodeId children() const {
+        return get_arena()->first_child[id].load(std::memory_order_acquire);
+    }
+
+    MCTSNode<Game> child(ActionIdxT action_idx) const {
+        NodeId block = children();
+        return block == NULL_NODE ? MCTSNode<Game>() : MCTSNode<Game>(block + action_idx);
+    }
+
+    // The NodeArena::INHERITED flags: set from SearchConfig on the root and
+    // inherited by every node below it
+    uint8_t inherited_flags() const {
+        return get_arena()->flags[id].load(std::memory_order_relaxed) & NodeArena::INHERITED;
+    }
+
+    static uint8_t inherited_flags(const SearchConfig& config){
+        return (config.selection == SelectionRule::PUCT ? NodeArena::PUCT : 0)
+             | (config.rollout == RolloutPolicy::Tactical ? NodeArena::TACTICAL : 0)
+             | (config.solver ? NodeArena::SOLVER : 0);
+    }
+
+    // Children are scored by PUCT
+    bool uses_puct() const {
+        return inherited_flags() & NodeArena::PUCT;
+    }
+
+    RolloutPolicy rollout_policy() const {
+        return inherited_flags() & NodeArena::TACTICAL ? RolloutPolicy::Tactical : RolloutPolicy::Uniform;
+    }
+
+    // A fresh, unevaluated node; player is the one who made the move into it
+    static void init(NodeArena& nodes, NodeId id, PlayerType player, uint8_t inherited){
+        uint8_t flags = (player == PlayerType(1) ? NodeArena::PLAYER1 : 0) | inherited;
+        nodes.visits[id].store(0, std::memory_order_relaxed);
+        nodes.W[id].store(0, std::memory_order_relaxed);
+        nodes.virtual_loss[id].store(0, std::memory_order_relaxed);
+        nodes.first_child[id].store(NULL_NODE, std::memory_order_relaxed);
+        nodes.flags[id].store(flags, std::memory_order_relaxed);
+        nodes.num_children[id] = 0;
+    }
+
+    // A fresh block from the arena; the one place the search allocates nodes
+    __attribute__((always_inline)) static NodeId allocate_block(NodeArena& nodes){
+        PhaseTimer timer(SearchPhase::Allocate);
+        return nodes.allocate();
+    }
+
+    // A root sits at the start of a block of its own
+    static MCTSNode<Game> new_root(PlayerType player, uint8_t inherited = 0){
+        NodeArena& nodes = *get_arena();
+        NodeId block = allocate_block(nodes);
+        init(nodes, block, player, inherited);
+        return MCTSNode<Game>(block);
+    }
+
+    // Children block with every slot initialised, moves made by player
+    static NodeId new_children(PlayerType player, uint8_t inherited){
+        NodeArena& nodes = *get_arena();
+        NodeId block = allocate_block(nodes);
+        for (int i = 0; i < MAX_CHILDREN; i++){
+            init(nodes, block + i, player, inherited);
+        }
+        return block;
+    }
+
+    // Fills block's priors from state, the position the block's moves are
+    // made from: a softmax over the Net's value of each child position for
+    // the player to move, with a finished game scored by its result.
+    // Padding slots get a prior of 0.
+    static void set_priors(Game& state, NodeId block){
+        NodeArena& nodes = *get_arena();
+        Game positions[Game::MAX_ACTIONS];
+        RewardT values[Game::MAX_ACTIONS];
+        PlayerType mover = state.player;
+        int count = state.num_actions;
+        for (ActionIdxT i = 0; i < count; i++){
+            state.copy_to(positions[i]);
+            positions[i].step(i);
+        }
+        net_rollouts(positions, count, values);
+        float logits[MAX_CHILDREN];
+        float max_logit = -INF;
+        for (ActionIdxT i = 0; i < count; i++){
+            double value = positions[i].is_terminal() ? positions[i].get_reward()[mover] : values[i][mover];
+            logits[i] = static_cast<float>(value) / PRIOR_TEMPERATURE;
+            max_logit = std::max(max_logit, logits[i]);
+        }
+        float total = 0;
+        for (ActionIdxT i = 0; i < count; i++){
+            logits[i] = std::exp(logits[i] - max_logit);
+            total += logits[i];
+        }
+        for (int i = 0; i < MAX_CHILDREN; i++){
+            nodes.prior[block + i] = i < count ? logits[i] / total : 0.0f;
+        }
+    }
+
+    // Roots only, in tree mode: releases the tree and the root's own block.
+    // Under a transposition table blocks are released through the table.
+    void delete_rec(){
+        assert(id % MAX_CHILDREN == 0);
+        release_children();
+        get_arena()->release(id);
+    }
+
+    // Tree mode: releases every block below this node
+    void release_children(){
+        NodeArena& nodes = *get_arena();
+        NodeId block = nodes.first_child[id].exchange(NULL_NODE, std::memory_order_relaxed);
+        if (block == NULL_NODE) return;
+        for (ActionIdxT i = 0; i < nodes.num_children[id]; i++){
+            MCTSNode<Game>(block + i).release_children();
+        }
+        nodes.release(block);
+    }
+
+    // Copy of the child reached by action_idx as a new root sharing its
+    // subtree, or a null node if the children were never allocated
+    MCTSNode<Game> child_as_root(ActionIdxT action_idx) const {
+        MCTSNode<Game> old_child = child(action_idx);
+        if (old_child.is_null()) return old_child;
+        NodeArena& nodes = *get_arena();
+        MCTSNode<Game> next = new_root(old_child.player());
+        NodeId from = old_child.id, to = next.id;
+        nodes.visits[to].store(nodes.visits[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nodes.W[to].store(nodes.W[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nodes.first_child[to].store(nodes.first_child[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        nodes.num_children[to] = nodes.num_children[from];
+        nodes.flags[to].store(nodes.flags[from].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return next;
+    }
+
+    // Tree mode: make the child reached by action_idx the new root and release
+    // the rest of the tree, this root included. Returns a null node if that
+    // child was never created, in which case the caller starts a fresh root.
+    MCTSNode<Game> promote_child(ActionIdxT action_idx){
+        MCTSNode<Game> next = child_as_root(action_idx);
+        if (!next.is_null()) {
+            get_arena()->first_child[children() + action_idx].store(NULL_NODE, std::memory_order_relaxed);
+        }
+        delete_rec();
+        return next;
+    }
+
+    // Adds every children block reachable from this node to reachable
+    void collect(std::unordered_set<NodeId>& reachable) const {
+        NodeId block = children();
+        if (block == NULL_NODE || !reachable.insert(block).second) return;
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            MCTSNode<Game>(block + i).collect(reachable);
+        }
+    }
+
+    // True for the one thread that gets to seed and expand this node
+    bool claim(){
+        return !(get_arena()->flags[id].fetch_or(NodeArena::EVALUATED, std::memory_order_acq_rel) & NodeArena::EVALUATED);
+    }
+
+    // Count a Net value as one visit of a freshly claimed leaf
+    void seed(double value){
+        NodeArena& nodes = *get_arena();
+        nodes.visits[id].fetch_add(1, std::memory_order_relaxed);
+        atomic_add(nodes.W[id], static_cast<float>(value));
+    }
+
+    RewardT expand(Game& game_state, Rng& rng){
+        RewardT reward = random_rollouts(game_state, NUM_ROLLOUTS, rng, rollout_policy());
+        expand(game_state);
+        return reward;
+    }
+
+    // Publishes a claimed node's children once its rollouts are done. A
+    // terminal node is not expanded; under the solver its result is proven.
+    void expand(Game& game_state){
+        assert(player() == game_state.get_prev_player());
+        NodeArena& nodes = *get_arena();
+        nodes.num_children[id] = game_state.num_actions;
+        if (!game_state.is_terminal()) {
+            nodes.flags[id].fetch_or(NodeArena::EXPANDED, std::memory_order_release);
+        } else if (inherited_flags() & NodeArena::SOLVER) {
+            double result = game_state.get_reward()[player()];
+            if (result != 0) {
+                nodes.flags[id].fetch_or(result > 0 ? NodeArena::PROVEN_WIN : NodeArena::PROVEN_LOSS,
+                                         std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // The proof the children in block give this node: lost if one of them
+    // is a proven win for the opponent, won if all of them are proven
+    // losses, else 0
+    uint8_t proof_from_children(NodeId block) const {
+        NodeArena& nodes = *get_arena();
+        bool all_lost = true;
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            uint8_t flags = nodes.flags[block + i].load(std::memory_order_relaxed);
+            if (flags & NodeArena::PROVEN_WIN) return NodeArena::PROVEN_LOSS;
+            all_lost &= (flags & NodeArena::PROVEN_LOSS) != 0;
+        }
+        return all_lost ? NodeArena::PROVEN_WIN : 0;
+    }
+
+    // path ends at a proven node; proves its ancestors in turn, up to the
+    // first one its children cannot settle yet
+    static void prove_ancestors(const Path& path){
+        NodeArena& nodes = *get_arena();
+        for (size_t depth = path.size() - 1; depth-- > 0; ){
+            MCTSNode<Game> node = path[depth];
+            if (node.is_proven()) return;
+            uint8_t proof = node.proof_from_children(node.children());
+            if (proof == 0) return;
+            nodes.flags[node.id].fetch_or(proof, std::memory_order_relaxed);
+        }
+    }
+
+    std::pair<MCTSNode<Game>, ActionIdxT> most_visited() const {
+        ActionIdxT best_action = best_child();
+        assert(best_action != -1);
+        return std::make_pair(child(best_action), best_action);
+    }
+
+    // The move most_visited plays: a proven win before any visit count, and
+    // a proven loss only when every move loses. -1 while no child has a
+    // visit, so it is safe to poll while a search runs.
+    ActionIdxT best_child() const {
+        NodeArena& nodes = *get_arena();
+        NodeId block = children();
+        if (block == NULL_NODE) return -1;
+        ActionIdxT best_action = -1, best_lost = -1;
+        int best_visits = 0, best_lost_visits = 0;
+        for(ActionIdxT i = 0; i < num_actions(); i++){
+            uint8_t flags = nodes.flags[block + i].load(std::memory_order_relaxed);
+            if (flags & NodeArena::PROVEN_WIN) return i;
+            int visits = nodes.visits[block + i].load(std::memory_order_relaxed);
+            if (flags & NodeArena::PROVEN_LOSS){
+                if (visits > best_lost_visits){
+                    best_lost = i;
+                    best_lost_visits = visits;
+                }
+            } else if (visits > best_visits){
+                best_action = i;
+                best_visits = visits;
+            }
+        }
+        return best_action != -1 ? best_action : best_lost;
+    }
+
+    // True once no other child can overtake the most visited one, or tie
+    // it, within remaining more iterations. Virtual loss counts the
+    // descents still in flight towards the child they will back up into.
+    bool decided(int64_t remaining) const {
+        NodeArena& nodes = *get_arena();
+        NodeId block = children();
+        if (block == NULL_NODE) return false;
+        ActionIdxT best = 0;
+        for (ActionIdxT i = 1; i < num_actions(); i++){
+            if (nodes.visits[block + i].load(std::memory_order_relaxed) > nodes.visits[block + best].load(std::memory_order_relaxed)){
+                best = i;
+            }
+        }
+        int64_t best_visits = nodes.visits[block + best].load(std::memory_order_relaxed);
+        if (best_visits == 0) return false;
+        int64_t runner_up = 0;
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            if (i == best) continue;
+            int64_t reach = nodes.visits[block + i].load(std::memory_order_relaxed)
+                + nodes.virtual_loss[block + i].load(std::memory_order_relaxed);
+            runner_up = std::max(runner_up, reach);
+        }
+        return num_actions() == 1 || best_visits - runner_up > remaining;
+    }
+
+    // True once the most visited child's Q sits z standard errors clear of
+    // every other child's. Rewards lie in [-1, 1], so a mean of Q allows a
+    // per-visit variance of at most 1 - Q^2; that bound, floored at
+    // MIN_VARIANCE so a few equal results do not read as certainty, stands
+    // in for the variance the nodes do not store.
+    bool confident(double z) const {
+        NodeArena& nodes = *get_arena();
+        NodeId block = children();
+        if (block == NULL_NODE || num_actions() < 2) return false;
+        double lower[Game::MAX_ACTIONS], upper[Game::MAX_ACTIONS];
+        ActionIdxT best = 0;
+        int best_visits = 0;
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            int n = nodes.visits[block + i].load(std::memory_order_relaxed);
+            if (n == 0) return false;
+            double q = nodes.W[block + i].load(std::memory_order_relaxed) / n;
+            double error = z * std::sqrt(std::max(1 - q * q, MIN_VARIANCE) / n);
+            lower[i] = q - error;
+            upper[i] = q + error;
+            if (n > best_visits){
+                best = i;
+                best_visits = n;
+            }
+        }
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            if (i != best && upper[i] >= lower[best]) return false;
+        }
+        return true;
+    }
+
+    std::pair<MCTSNode<Game>, ActionIdxT> dirichlet_select(Rng& rng) const {
+        NodeArena& nodes = *get_arena();
+        NodeId block = children();
+        assert(block != NULL_NODE);
+        std::vector<double> action_probs(num_actions(), 0.0);
+        double sum_probs = 0.0;
+        double dirichlet_alpha = 0.3;
+
+        // Calculate softmax probabilities based on Q values; proven results
+        // are played as most_visited plays them
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            uint8_t flags = nodes.flags[block + i].load(std::memory_order_relaxed);
+            if (flags & NodeArena::PROVEN_WIN) return std::make_pair(MCTSNode<Game>(block + i), i);
+            int visits = nodes.visits[block + i].load(std::memory_order_relaxed);
+            if (visits > 0 && !(flags & NodeArena::PROVEN_LOSS)){
+                action_probs[i] = visits + dirichlet_alpha;
+                sum_probs += action_probs[i];
+            }
+        }
+        if (sum_probs == 0) return most_visited();
+
+        // Normalize probabilities
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            action_probs[i] /= sum_probs;
+        }
+
+        // Select action based on probabilities
+        double rand_val = rng.uniform();
+        double cumulative_prob = 0.0;
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            cumulative_prob += action_probs[i];
+            if (rand_val < cumulative_prob && action_probs[i] > 0){
+                return std::make_pair(MCTSNode<Game>(block + i), i);
+            }
+        }
+        // Fallback: return most visited if we reach here
+        return most_visited();
+    }
+
+    // UCB score of every slot in a children block. A child with neither
+    // visits nor virtual loss scores INF; each unit of virtual loss counts as
+    // a lost playout. The AVX2 path reads eight children per load straight
+    // from the atomic arrays: each aligned lane is read whole, which is all
+    // the relaxed scalar loads of the fallback guarantee either.
+    // ThreadSanitizer cannot see that, so sanitized builds take the scalar path.
+    static void ucb_scores(const NodeArena& nodes, NodeId block, float log_n, float* scores){
+        const float c = 2 * log_n;
+#if defined(__AVX2__) && !defined(__SANITIZE_THREAD__)
+        static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t) && std::atomic<int32_t>::is_always_lock_free);
+        static_assert(sizeof(std::atomic<int16_t>) == sizeof(int16_t) && std::atomic<int16_t>::is_always_lock_free);
+        static_assert(sizeof(std::atomic<float>) == sizeof(float) && std::atomic<float>::is_always_lock_free);
+        const int32_t* visits = reinterpret_cast<const int32_t*>(nodes.visits + block);
+        const int16_t* vl = reinterpret_cast<const int16_t*>(nodes.virtual_loss + block);
+        const float* w = reinterpret_cast<const float*>(nodes.W + block);
+        const __m256 explore = _mm256_set1_ps(c);
+        const __m256 inf = _mm256_set1_ps(INF);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (int i = 0; i < MAX_CHILDREN; i += SIMD_WIDTH){
+            __m256i losses = _mm256_cvtepi16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(vl + i)));
+            __m256i count = _mm256_add_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(visits + i)), losses);
+            __m256 n = _mm256_cvtepi32_ps(count);
+            __m256 unvisited = _mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_EQ_OQ);
+            n = _mm256_blendv_ps(n, one, unvisited);
+            __m256 q = _mm256_div_ps(_mm256_sub_ps(_mm256_load_ps(w + i), _mm256_cvtepi32_ps(losses)), n);
+            __m256 u = _mm256_sqrt_ps(_mm256_div_ps(explore, n));
+            _mm256_store_ps(scores + i, _mm256_blendv_ps(_mm256_add_ps(q, u), inf, unvisited));
+        }
+#else
+        for (int i = 0; i < MAX_CHILDREN; i++){
+            int vl = nodes.virtual_loss[block + i].load(std::memory_order_relaxed);
+            int n = nodes.visits[block + i].load(std::memory_order_relaxed) + vl;
+            if (n == 0){
+                scores[i] = INF;
+            } else {
+                float q = (nodes.W[block + i].load(std::memory_order_relaxed) - static_cast<float>(vl)) / static_cast<float>(n);
+                scores[i] = q + std::sqrt(c / static_cast<float>(n));
+            }
+        }
+#endif
+    }
+
+    // PUCT score of every slot in a children block:
+    // Q + C_PUCT * prior * sqrt(parent visits) / (1 + n), with n and Q
+    // counting virtual loss as for UCB. A child with neither visits nor
+    // virtual loss takes fpu as its Q, so unvisited children rank by prior.
+    static void puct_scores(const NodeArena& nodes, NodeId block, float sqrt_n, float fpu, float* scores){
+        const float c = C_PUCT * sqrt_n;
+#if defined(__AVX2__) && !defined(__SANITIZE_THREAD__)
+        const int32_t* visits = reinterpret_cast<const int32_t*>(nodes.visits + block);
+        const int16_t* vl = reinterpret_cast<const int16_t*>(nodes.virtual_loss + block);
+        const float* w = reinterpret_cast<const float*>(nodes.W + block);
+        const __m256 explore = _mm256_set1_ps(c);
+        const __m256 first_play = _mm256_set1_ps(fpu);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (int i = 0; i < MAX_CHILDREN; i += SIMD_WIDTH){
+            __m256i losses = _mm256_cvtepi16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(vl + i)));
+            __m256i count = _mm256_add_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(visits + i)), losses);
+            __m256 n = _mm256_cvtepi32_ps(count);
+            __m256 unvisited = _mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_EQ_OQ);
+            __m256 q = _mm256_div_ps(_mm256_sub_ps(_mm256_load_ps(w + i), _mm256_cvtepi32_ps(losses)),
+                                     _mm256_blendv_ps(n, one, unvisited));
+            q = _mm256_blendv_ps(q, first_play, unvisited);
+            __m256 u = _mm256_div_ps(_mm256_mul_ps(explore, _mm256_load_ps(nodes.prior + block + i)), _mm256_add_ps(n, one));
+            _mm256_store_ps(scores + i, _mm256_add_ps(q, u));
+        }
+#else
+        for (int i = 0; i < MAX_CHILDREN; i++){
+            int vl = nodes.virtual_loss[block + i].load(std::memory_order_relaxed);
+            int n = nodes.visits[block + i].load(std::memory_order_relaxed) + vl;
+            float q = n == 0 ? fpu
+                : (nodes.W[block + i].load(std::memory_order_relaxed) - static_cast<float>(vl)) / static_cast<float>(n);
+            scores[i] = q + c * nodes.prior[block + i] / (static_cast<float>(n) + 1.0f);
+        }
+#endif
+    }
+
+    // Returns the action with the highest UCB (or PUCT) score among this
+    // node's children in block and adds virtual loss to that child. Under
+    // the solver, children proven lost for the mover are passed over. The
+    // chosen child's fields are prefetched while the caller steps the game.
+    ActionIdxT ucb_select(NodeId block) const {
+        PhaseTimer timer(SearchPhase::Select);
+        NodeArena& nodes = *get_arena();
+        alignas(32) float scores[MAX_CHILDREN];
+        float n = static_cast<float>(nodes.visits[id].load(std::memory_order_relaxed));
+        uint8_t inherited = inherited_flags();
+        if (inherited & NodeArena::PUCT){
+            // This node's value is from the other side's view; flip it for the children
+            float fpu = -static_cast<float>(get_Q()) - FPU_REDUCTION;
+            puct_scores(nodes, block, std::sqrt(n), fpu, scores);
+        } else {
+            ucb_scores(nodes, block, std::log(n), scores);
+        }
+        if (inherited & NodeArena::SOLVER){
+            for (ActionIdxT i = 0; i < nodes.num_children[id]; i++){
+                if (nodes.flags[block + i].load(std::memory_order_relaxed) & NodeArena::PROVEN_LOSS){
+                    scores[i] = -INF;
+                }
+            }
+        }
+        ActionIdxT best_action = 0;
+        for (ActionIdxT i = 1; i < nodes.num_children[id]; i++){
+            if (scores[i] > scores[best_action]){
+                best_action = i;
+            }
+        }
+        NodeId best = block + best_action;
+        nodes.virtual_loss[best].fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+        __builtin_prefetch(&nodes.flags[best]);
+        __builtin_prefetch(&nodes.first_child[best]);
+        __builtin_prefetch(&nodes.num_children[best]);
+        return best_action;
+    }
+
+    // The children block, allocated by the first descent that selects from
+    // this node; state is this node's position. With a transposition table
+    // every node for the same position shares one block, and with it the
+    // subtree below.
+    NodeId get_or_create_children(Game& state, TT* tt){
+        NodeArena& nodes = *get_arena();
+        NodeId block = nodes.first_child[id].load(std::memory_order_acquire);
+        if (block != NULL_NODE) return block;
+        PlayerType mover = PlayerType(player() ^ 1);
+        uint8_t inherited = inherited_flags();
+        auto create = [&]() {
+            NodeId created = new_children(mover, inherited);
+            if (inherited & NodeArena::PUCT) set_priors(state, created);
+            return created;
+        };
+        NodeId fresh = NULL_NODE;
+        if (tt != nullptr){
+            bool inserted;
+            block = tt->find_or_insert(state.hash, create, inserted);
+        } else {
+            block = fresh = create();
+        }
+        NodeId linked = NULL_NODE;
+        if (!nodes.first_child[id].compare_exchange_strong(linked, block, std::memory_order_acq_rel)){
+            // Another thread linked first; with a table it linked the same block
+            nodes.release(fresh);
+            assert(tt == nullptr || linked == block);
+            return linked;
+        }
+        return block;
+    }
+
+    // Back up result along the nodes one descent visited. Walking the recorded
+    // path instead of parent links keeps this correct once a block has several
+    // parents. Every node below the root carries one virtual loss to remove.
+    static void backup(const Path& path, RewardT result){
+        PhaseTimer timer(SearchPhase::Backup);
+        NodeArena& nodes = *get_arena();
+        for (size_t depth = 0; depth < path.size(); depth++){
+            MCTSNode<Game> node = path[depth];
+            nodes.visits[node.id].fetch_add(1, std::memory_order_relaxed);
+            atomic_add(nodes.W[node.id], static_cast<float>(result[node.player()]));
+            if (depth > 0){
+                nodes.virtual_loss[node.id].fetch_sub(VIRTUAL_LOSS, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Select down to a leaf, recording the path; state ends at the leaf position
+    MCTSNode<Game> descend(Game& game_state, Game& state, Path& path, TT* tt) const {
+        MCTSNode<Game> node = *this;
+        game_state.copy_to(state);
+        path.clear();
+        path.push_back(node);
+        while (node.is_selectable()){
+            NodeId block = node.get_or_create_children(state, tt);
+            ActionIdxT action = node.ucb_select(block);
+            state.step(action);
+            node = MCTSNode<Game>(block + action);
+            path.push_back(node);
+        }
+        return node;
+    }
+
+    // One select/evaluate/backup pass from this node
+    void iterate(Game& game_state, Scratch& scratch, TT* tt){
+        Game& state = scratch.states[0];
+        Path& path = scratch.paths[0];
+        MCTSNode<Game> node = descend(game_state, state, path, tt);
+        RewardT reward;
+        if (node.is_proven()){
+            reward = node.proven_reward();
+        } else if (node.claim()){
+            // Seed the node with the heuristic evaluation as a pseudo-visit
+            node.seed(net_rollout(state)[node.player()]);
+            reward = node.expand(state, scratch.rng);
+        } else {
+            // Terminal node, or a leaf another thread is still expanding
+            reward = random_rollouts(state, NUM_ROLLOUTS, scratch.rng, node.rollout_policy());
+        }
+        backup(path, reward);
+        if (node.is_proven()) prove_ancestors(path);
+    }
+
+    // count iterations as one batch: select count leaves (virtual loss keeps
+    // them apart), seed them with a single Net::forward_batch call, play all
+    // their rollouts in one random_rollouts call, then expand and back up
+    // each. scratch must hold count positions and paths.
+    void iterate_batch(Game& game_state, Scratch& scratch, int count, TT* tt){
+        assert(count <= MAX_BATCH);
+        MCTSNode<Game> leaves[MAX_BATCH];
+        RewardT values[MAX_BATCH];
+        int num_leaves = 0;
+        for (int k = 0; k < count; k++){
+            Game& state = scratch.states[num_leaves];
+            Path& path = scratch.paths[num_leaves];
+            MCTSNode<Game> node = descend(game_state, state, path, tt);
+            if (node.is_proven()){
+                backup(path, node.proven_reward());
+                prove_ancestors(path);
+            } else if (node.claim()){
+                leaves[num_leaves++] = node;
+            } else {
+                // Terminal node, or a leaf already waiting in a batch
+                backup(path, random_rollouts(state, NUM_ROLLOUTS, scratch.rng, node.rollout_policy()));
+            }
+        }
+        net_rollouts(scratch.states.data(), num_leaves, values);
+        for (int j = 0; j < num_leaves; j++){
+            leaves[j].seed(values[j][leaves[j].player()]);
+        }
+        random_rollouts(scratch.states.data(), num_leaves, NUM_ROLLOUTS, scratch.rng, values, rollout_policy());
+        for (int j = 0; j < num_leaves; j++){
+            leaves[j].expand(scratch.states[j]);
+            backup(scratch.paths[j], values[j]);
+            if (leaves[j].is_proven()) prove_ancestors(scratch.paths[j]);
+        }
+    }
+
+    // Runs iterations until budget is spent, on a stream split from rng
+    void traverse(SearchBudget& budget, Game& game_state, Rng& rng, TT* tt = nullptr){
+        NetPin pin;
+        Scratch scratch(1, rng.split());
+        while (budget.claim(1) > 0){
+            iterate(game_state, scratch, tt);
+        }
+    }
+
+    void traverse(int num_iters, Game& game_state, TT* tt = nullptr){
+        SearchBudget budget(num_iters);
+        Rng rng;
+        traverse(budget, game_state, rng, tt);
+    }
+
+    void traverse_batched(SearchBudget& budget, Game& game_state, Rng& rng, int batch_size, TT* tt = nullptr){
+        batch_size = std::min(batch_size, MAX_BATCH);
+        if (batch_size <= 1){
+            traverse(budget, game_state, rng, tt);
+            return;
+        }
+        NetPin pin;
+        Scratch scratch(batch_size, rng.split());
+        // A batch from an unexpanded root would collide on the root itself
+        if (!is_expanded() && budget.claim(1) > 0){
+            iterate(game_state, scratch, tt);
+        }
+        int count;
+        while ((count = budget.claim(batch_size)) > 0){
+            iterate_batch(game_state, scratch, count, tt);
+        }
+    }
+
+    void traverse_batched(int num_iters, Game& game_state, int batch_size, TT* tt = nullptr){
+        SearchBudget budget(num_iters);
+        Rng rng;
+        traverse_batched(budget, game_state, rng, batch_size, tt);
+    }
+
+    // Tree-parallel search: num_threads workers share this tree and draw
+    // iterations from one budget. Virtual loss keeps concurrent descents
+    // apart. Each worker gets its own stream split from rng.
+    void traverse_parallel(SearchBudget& budget, Game& game_state, Rng& rng, int num_threads, int batch_size = 1, TT* tt = nullptr){
+        batch_size = std::max(1, std::min(batch_size, MAX_BATCH));
+        if (num_threads <= 1){
+            traverse_batched(budget, game_state, rng, batch_size, tt);
+            return;
+        }
+        // Workers evaluate with the caller's net and count into its profile
+        NetPin pin;
+        std::shared_ptr<Net> net = pin.get();
+        SearchProfile* profile = SearchProfile::active();
+        // Expand the root before fanning out so every worker starts by selecting
+        if (!is_expanded()){
+            Scratch scratch(1, rng.split());
+            if (budget.claim(1) == 0) return;
+            iterate(game_state, scratch, tt);
+        }
+        MCTSNode<Game> root = *this;
+        auto worker = [root, &game_state, &budget, batch_size, tt, net, profile](Rng stream) mutable {
+            NetPin pin(net);
+            ProfileScope scope(profile);
+            Scratch scratch(batch_size, stream);
+            int count;
+            while ((count = budget.claim(batch_size)) > 0){
+                if (count == 1){
+                    root.iterate(game_state, scratch, tt);
+                } else {
+                    root.iterate_batch(game_state, scratch, count, tt);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int t = 1; t < num_threads; t++){
+            threads.emplace_back(worker, rng.split());
+        }
+        worker(rng.split());
+        for (auto& thread : threads){
+            thread.join();
+        }
+    }
+
+    void traverse_parallel(int num_iters, Game& game_state, int num_threads, int batch_size = 1, TT* tt = nullptr){
+        SearchBudget budget(num_iters);
+        Rng rng;
+        traverse_parallel(budget, game_state, rng, num_threads, batch_size, tt);
+    }
+
+    // Root-parallel search: each thread searches a private tree from the same
+    // position, drawing from one budget, then the per-child statistics are
+    // merged into this root, and added to merged if given. The private trees
+    // never use the transposition table. This root is expanded before the
+    // helpers start, so their statistics always have children to go to.
+    void traverse_root_parallel(SearchBudget& budget, Game& game_state, Rng& rng, int num_threads, int batch_size = 1,
+                                TT* tt = nullptr, RootMerge* merged = nullptr){
+        // A tree leaves a move to play once it has MIN_ITERS iterations, so
+        // every thread gets that many to go on
+        num_threads = static_cast<int>(std::min<int64_t>(num_threads, budget.remaining() / SearchBudget::MIN_ITERS));
+        if (num_threads <= 1){
+            traverse_batched(budget, game_state, rng, batch_size, tt);
+            return;
+        }
+        NetPin pin;
+        std::shared_ptr<Net> net = pin.get();
+        if (!is_expanded()){
+            Scratch scratch(1, rng.split());
+            if (budget.claim(1) == 0) return;
+            iterate(game_state, scratch, tt);
+        }
+        SearchProfile* profile = SearchProfile::active();
+        std::vector<MCTSNode<Game>> roots(num_threads);
+        roots[0] = *this;
+        for (int t = 1; t < num_threads; t++){
+            roots[t] = new_root(player(), inherited_flags());
+        }
+        std::vector<std::thread> threads;
+        for (int t = 1; t < num_threads; t++){
+            threads.emplace_back([&roots, &game_state, &budget, t, batch_size, net, profile](Rng stream) {
+                NetPin pin(net);
+                ProfileScope scope(profile);
+                roots[t].traverse_batched(budget, game_state, stream, batch_size);
+            }, rng.split());
+        }
+        traverse_batched(budget, game_state, rng, batch_size, tt);
+        for (auto& thread : threads){
+            thread.join();
+        }
+        for (int t = 1; t < num_threads; t++){
+            merge_root(roots[t], game_state, tt, merged);
+            roots[t].delete_rec();
+        }
+    }
+
+    // Fold another root's statistics for the same position into this one,
+    // the root and its children alike, adding what was folded in to merged.
+    // A terminal root has no children to fold.
+    void merge_root(MCTSNode<Game> other, Game& game_state, TT* tt, RootMerge* merged = nullptr){
+        assert(player() == other.player());
+        NodeArena& nodes = *get_arena();
+        int visits = nodes.visits[other.id].load(std::memory_order_relaxed);
+        float W = nodes.W[other.id].load(std::memory_order_relaxed);
+        nodes.visits[id].fetch_add(visits, std::memory_order_relaxed);
+        atomic_add(nodes.W[id], W);
+        if (merged != nullptr){
+            merged->visits += visits;
+            merged->W += W;
+        }
+        NodeId theirs = other.children();
+        if (theirs == NULL_NODE || !is_expanded()) return;
+        assert(num_actions() == other.num_actions());
+        NodeId ours = get_or_create_children(game_state, tt);
+        if (merged != nullptr){
+            merged->child_visits.resize(num_actions(), 0);
+            merged->child_W.resize(num_actions(), 0);
+        }
+        for (ActionIdxT i = 0; i < num_actions(); i++){
+            visits = nodes.visits[theirs + i].load(std::memory_order_relaxed);
+            W = nodes.W[theirs + i].load(std::memory_order_relaxed);
+            nodes.visits[ours + i].fetch_add(visits, std::memory_order_relaxed);
+            atomic_add(nodes.W[ours + i], W);
+            if (merged != nullptr){
+                merged->child_visits[i] += visits;
+                merged->child_W[i] += W;
+            }
+        }
+    }
+
+    // Takes what merge_root folded into this root back out, leaving the
+    // statistics of the main tree alone, and empties merged
+    void unmerge(RootMerge& merged){
+        NodeArena& nodes = *get_arena();
+        nodes.visits[id].fetch_sub(merged.visits, std::memory_order_relaxed);
+        atomic_add(nodes.W[id], -merged.W);
+        NodeId block = children();
+        for (size_t i = 0; i < merged.child_visits.size() && block != NULL_NODE; i++){
+            nodes.visits[block + i].fetch_sub(merged.child_visits[i], std::memory_order_relaxed);
+            atomic_add(nodes.W[block + i], -merged.child_W[i]);
+        }
+        merged = RootMerge();
+    }
+
+    // Searches in config's mode until budget is spent, on streams split from
+    // rng; a root-parallel search adds what it merges in to merged
+    void search(Game& game_state, SearchBudget& budget, const SearchConfig& config, Rng& rng, TT* tt = nullptr,
+                RootMerge* merged = nullptr){
+        switch (config.mode){
+            case SearchMode::Serial:
+                traverse_batched(budget, game_state, rng, config.batch_size, tt);
+                break;
+            case SearchMode::TreeParallel:
+                traverse_parallel(budget, game_state, rng, config.num_threads, config.batch_size, tt);
+                break;
+            case SearchMode::RootParallel:
+                traverse_root_parallel(budget, game_state, rng, config.num_threads, config.batch_size, tt, merged);
+                break;
+        }
+    }
+
+    void search(Game& game_state, const SearchConfig& config, TT* tt = nullptr){
+        SearchBudget budget(config);
+        Rng rng(config.seed);
+        search(game_state, budget, config, rng, tt);
+    }
+
+    void print() const {
+        std::cout << "Q: " << get_Q() << std::endl;
+        std::cout << "n_visits: " << n_visits() << std::endl;
+        std::cout << "num_actions: " << num_actions() << std::endl;
+        std::cout << "is_expanded: " << is_expanded() << std::endl;
+    }
+};
+
+// Static member definitions
+template <typename Game>
+std::atomic<NodeArena*> MCTSNode<Game>::arena(nullptr);
+
+template <typename Game>
+std::shared_ptr<typename MCTSNode<Game>::Net> MCTSNode<Game>::hf_net;
+
+template <typename Game>
+thread_local const std::shared_ptr<typename MCTSNode<Game>::Net>* MCTSNode<Game>::pinned_hf_net = nullptr;
+
+template <typename Game>
+std::mutex MCTSNode<Game>::init_mutex;
+
+// Owns the search for one game: the root node, the transposition table when
+// config.use_transpositions is set, and the node lifetime rules that go with
+// them. Tree blocks are released recursively, DAG blocks through the table.
+template <typename Game>
+class SearchTree {
+    public:
+    using Node = MCTSNode<Game>;
+    using ActionIdxT = typename Node::ActionIdxT;
+
+    SearchConfig config;
+    Node root;
+    // Seeded from config.seed; every search splits its threads' streams
+    // from it, and callers sampling moves can draw from it too
+    Rng rng;
+
+    explicit SearchTree(const SearchConfig& config) : config(config), rng(config.seed) {
+        if (config.use_transpositions) {
+            tt = std::make_unique<typename Node::TT>();
+        }
+    }
+
+    ~SearchTree(){
+        clear();
+    }
+
+    SearchTree(const SearchTree&) = delete;
+    SearchTree& operator=(const SearchTree&) = delete;
+
+    // Searches game from the current root within config's iteration and
+    // time limits, creating the root if needed
+    Node search(Game& game){
+        SearchBudget budget(config);
+        return search(game, budget);
+    }
+
+    // Anytime search: runs until budget is spent or stopped and returns the
+    // root, whose children hold the best move found so far. Stops pondering first.
+    Node search(Game& game, SearchBudget& budget){
+        stop_pondering();
+        return run(game, budget);
+    }
+
+    // Keeps searching game, the position at the root, on a background
+    // thread until the next search(), advance() or clear(). Meant for the
+    // opponent's time after our move: advancing by the move they play keeps
+    // the subtree pondering grew under it, given reuse_tree. Nothing else
+    // may touch the tree, or tree.rng, while it runs. It evaluates with the
+    // caller's net, pinned or else published, like the caller's own searches.
+    void ponder(Game& game){
+        stop_pondering();
+        game.copy_to(ponder_position);
+        std::shared_ptr<typename Node::Net> net = typename Node::NetPin().get();
+        pondering.start([this, net](SearchBudget& budget) {
+            typename Node::NetPin pin(net);
+            run(ponder_position, budget);
+        });
+    }
+
+    // Stops pondering, if running; returns the iterations it ran
+    int64_t stop_pondering(){
+        return pondering.stop();
+    }
+
+    bool is_pondering() const {
+        return pondering.active();
+    }
+
+    // The most visited move after searching game within budget, and its node
+    std::pair<Node, ActionIdxT> best_move(Game& game, SearchBudget& budget){
+        return search(game, budget).most_visited();
+    }
+
+    // Blocks held by this tree, the root's own included
+    size_t blocks_in_use(){
+        if (root.is_null()) return 0;
+        if (tt) return tt->size() + 1;
+        return 1 + count_blocks(root);
+    }
+
+    // Shrinks the tree to at most target blocks by collapsing its least
+    // visited nodes back into leaves. A collapsed node keeps its own visit
+    // and value totals, which already fold in every playout through its
+    // subtree, so its parent's statistics are untouched; its children are
+    // rebuilt from scratch if the search returns to it. Ties in visits go
+    // by walk order, so which nodes are collapsed depends on the tree's
+    // shape and not on where the arena happened to put them.
+    void prune(size_t target){
+        if (root.is_null() || target == 0) return;
+        std::vector<std::tuple<int, size_t, NodeId>> owners;
+        std::unordered_set<NodeId> seen;
+        gather_owners(root, owners, seen);
+        if (owners.size() + 1 <= target) return;
+        auto cut = owners.begin() + (owners.size() - (target - 1));
+        std::nth_element(owners.begin(), cut, owners.end());
+        std::unordered_set<NodeId> collapse;
+        for (auto it = owners.begin(); it != cut; ++it) {
+            collapse.insert(std::get<2>(*it));
+        }
+        seen.clear();
+        collapse_nodes(root, collapse, seen);
+        if (tt) {
+            std::unordered_set<NodeId> reachable;
+            root.collect(reachable);
+            tt->retain(reachable, release);
+        }
+    }
+
+    // action_idx was played from the root position. Keeps what is reachable
+    // from the new position when reuse_tree is set.
+    void advance(ActionIdxT action_idx){
+        stop_pondering();
+        if (root.is_null()) return;
+        root.unmerge(merged);
+        if (!config.reuse_tree) {
+            clear();
+            return;
+        }
+        if (tt) {
+            Node next = root.child_as_root(action_idx);
+            std::unordered_set<NodeId> reachable;
+            if (!next.is_null()) next.collect(reachable);
+            tt->retain(reachable, release);
+            release(root.id);
+            root = next;
+        } else {
+            root = root.promote_child(action_idx);
+        }
+    }
+
+    void clear(){
+        stop_pondering();
+        if (tt) {
+            tt->clear(release);
+            release(root.id);
+        } else if (!root.is_null()) {
+            root.delete_rec();
+        }
+        root = Node();
+        merged = typename Node::RootMerge();
+    }
+
+    // Children blocks in the transposition table; 0 in tree mode
+    size_t table_size(){
+        return tt ? tt->size() : 0;
+    }
+
+    // Time per search phase in the last search, and summed over every
+    // search this tree has run, pondering included. Always empty unless
+    // built with MCTS_PROFILE, and for a search run under a ProfileScope
+    // of the caller's, whose profile counts it instead.
+    const PhaseCounts& last_profile() const {
+        return last_counts;
+    }
+
+    const PhaseCounts& profile() const {
+        return total_counts;
+    }
+
+    private:
+    // Share of the node budget kept when pruning
+    static constexpr double PRUNE_TARGET = 0.75;
+    // Iterations between checks of the early stop rules
+    static constexpr int64_t STOP_CHECK_INTERVAL = 32;
+
+    std::unique_ptr<typename Node::TT> tt;
+    SearchHandle pondering;
+    Game ponder_position;
+    PhaseCounts last_counts;
+    PhaseCounts total_counts;
+    // What the last root-parallel search merged into the root, taken back
+    // out before the root is searched again or advanced
+    typename Node::RootMerge merged;
+
+    // search() without the stop_pondering(), so pondering can run it too,
+    // collecting the phase counts of every thread it searches on
+    Node run(Game& game, SearchBudget& budget){
+        if constexpr (SearchProfile::ENABLED) {
+            SearchProfile collected;
+            {
+                ProfileScope scope(&collected);
+                run_search(game, budget);
+            }
+            last_counts = collected.counts();
+            total_counts.merge(last_counts);
+            return root;
+        } else {
+            return run_search(game, budget);
+        }
+    }
+
+    // With a node budget the search runs in slices no larger than the blocks
+    // still free, pruning back to PRUNE_TARGET of the node budget when it
+    // runs short. A descent allocates at most one block in the common case,
+    // so the tree stays within the budget up to the odd extra block a
+    // transposition adds.
+    Node run_search(Game& game, SearchBudget& budget){
+        if (root.is_null()) {
+            root = Node::new_root(game.get_prev_player(), Node::inherited_flags(config));
+        }
+        root.unmerge(merged);
+        // A proof holds in any one tree, but root-parallel statistics are
+        // only complete once merged, so the visit and Q rules would judge
+        // one tree of several
+        bool root_parallel = config.mode == SearchMode::RootParallel;
+        bool early_stop = config.early_stop && !root_parallel;
+        double z = root_parallel ? 0 : config.stop_confidence;
+        bool solver = config.solver;
+        if (early_stop || z > 0 || solver) {
+            Node search_root = root;
+            budget.set_stop_check([search_root, z, early_stop, solver](int64_t remaining) {
+                return (solver && search_root.is_proven()) || (early_stop && search_root.decided(remaining))
+                    || (z > 0 && search_root.confident(z));
+            }, STOP_CHECK_INTERVAL);
+        }
+        if (config.max_nodes == 0) {
+            root.search(game, budget, config, rng, tt.get(), &merged);
+            return root;
+        }
+        size_t node_budget = std::max<size_t>(2, config.max_nodes / Node::MAX_CHILDREN);
+        size_t min_headroom = std::max<size_t>(1, node_budget / 16);
+        while (!budget.exhausted()){
+            size_t used = blocks_in_use();
+            if (used + min_headroom > node_budget) {
+                prune(static_cast<size_t>(node_budget * PRUNE_TARGET));
+                used = blocks_in_use();
+            }
+            SearchBudget slice(std::max<size_t>(1, node_budget - std::min(used, node_budget)), budget);
+            root.search(game, slice, config, rng, tt.get(), &merged);
+        }
+        return root;
+    }
+
+    // Tree mode only: blocks below node
+    static size_t count_blocks(Node node){
+        NodeId block = node.children();
+        if (block == NULL_NODE) return 0;
+        size_t count = 1;
+        for (ActionIdxT i = 0; i < node.num_actions(); i++){
+            count += count_blocks(Node(block + i));
+        }
+        return count;
+    }
+
+    // (visits, walk order, node) for every node below node that owns a
+    // children block. The walk takes children in action order, so walk order
+    // is the order of the action paths from node (the first path to it in a
+    // DAG). seen holds the blocks already walked, which a DAG reaches more
+    // than once.
+    static void gather_owners(Node node, std::vector<std::tuple<int, size_t, NodeId>>& owners,
+                              std::unordered_set<NodeId>& seen){
+        NodeId block = node.children();
+        if (block == NULL_NODE || !seen.insert(block).second) return;
+        for (ActionIdxT i = 0; i < node.num_actions(); i++){
+            Node child(block + i);
+            if (child.children() != NULL_NODE) {
+                owners.emplace_back(child.n_visits(), owners.size(), child.id);
+            }
+            gather_owners(child, owners, seen);
+        }
+    }
+
+    // Detaches the children of every node in collapse. In tree mode the
+    // detached subtrees are released here; under a table the caller releases
+    // whatever is no longer reachable.
+    void collapse_nodes(Node node, const std::unordered_set<NodeId>& collapse, std::unordered_set<NodeId>& seen){
+        NodeId block = node.children();
+        if (block == NULL_NODE || !seen.insert(block).second) return;
+        for (ActionIdxT i = 0; i < node.num_actions(); i++){
+            Node child(block + i);
+            if (collapse.count(child.id) == 0) {
+                collapse_nodes(child, collapse, seen);
+            } else if (tt) {
+                Node::get_arena()->first_child[child.id].store(NULL_NODE, std::memory_order_relaxed);
+            } else {
+                child.release_children();
+            }
+        }
+    }
+
+    static void release(NodeId block){
+        Node::get_arena()->release(block);
+    }
+};
+
+#endif // MCTS_HPP
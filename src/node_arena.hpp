@@ -0,0 +1,264 @@
+#ifndef NODE_ARENA_HPP
+#define NODE_ARENA_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+
+using NodeId = uint32_t;
+constexpr NodeId NULL_NODE = 0;
+
+// Search tree storage: one array per node field, indexed by 32-bit NodeId.
+// Nodes are handed out in fixed-size blocks of consecutive ids, one block per
+// expanded node holding all of its children, so scanning a node's children
+// reads each field as one contiguous run. Blocks are block_size-aligned, which
+// keeps those runs SIMD-aligned.
+//
+// The arrays are address space reserved with mmap for the full capacity,
+// inaccessible until the bump pointer reaches them. It opens them for
+// reading and writing COMMIT_STEP ids at a time, which is what the kernel
+// charges against its commit limit, and pages become resident as they are
+// first touched. Fresh blocks come from the bump pointer, so the capacity is
+// never walked and resident memory follows the high-water mark of the tree;
+// released blocks go on a free list for reuse, and trim() hands every page
+// back once the arena is empty. Where the address space for the capacity
+// cannot be had (a low RLIMIT_AS), the arena halves its capacity until it
+// can, down to MIN_CAPACITY.
+class NodeArena{
+    public:
+    // flags bits
+    static constexpr uint8_t PLAYER1 = 1;   // Player1 made the move into the node
+    static constexpr uint8_t EVALUATED = 2; // Claimed by the thread that seeds and expands it
+    static constexpr uint8_t EXPANDED = 4;  // num_children is set and the node can be selected through
+    static constexpr uint8_t PUCT = 8;      // Children are scored by PUCT against their priors
+    static constexpr uint8_t TACTICAL = 16; // Rollouts from the node use RolloutPolicy::Tactical
+    static constexpr uint8_t SOLVER = 32;   // Terminal results are proven and propagated up
+    static constexpr uint8_t INHERITED = PUCT | TACTICAL | SOLVER; // Search settings every child copies from its parent
+    // Solver: the player who moved into the node wins, or loses, with best play
+    static constexpr uint8_t PROVEN_WIN = 64;
+    static constexpr uint8_t PROVEN_LOSS = 128;
+    static constexpr uint8_t PROVEN = PROVEN_WIN | PROVEN_LOSS;
+
+    static constexpr size_t BYTES_PER_NODE = sizeof(std::atomic<int32_t>) + sizeof(std::atomic<float>)
+        + sizeof(std::atomic<int16_t>) + sizeof(std::atomic<NodeId>) + sizeof(std::atomic<uint8_t>) + sizeof(uint8_t)
+        + sizeof(float);
+
+    // Ids opened for use at a time: a multiple of the page size for every array
+    static constexpr size_t COMMIT_STEP = size_t(1) << 20;
+    static constexpr size_t MIN_CAPACITY = COMMIT_STEP;
+
+    std::atomic<int32_t>* visits;
+    std::atomic<float>* W; // Sum of rewards from the perspective of the player who moved into the node
+    std::atomic<int16_t>* virtual_loss;
+    std::atomic<NodeId>* first_child; // Children block, or NULL_NODE; links the free list when released
+    std::atomic<uint8_t>* flags;
+    uint8_t* num_children;
+    float* prior; // PUCT only: written before the block is linked, then read-only
+
+    // Throws std::bad_alloc if not even MIN_CAPACITY can be reserved
+    NodeArena(size_t capacity, int block_size);
+    ~NodeArena();
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // First id of an uninitialised block; throws std::bad_alloc when full or
+    // when the kernel refuses to commit more memory
+    NodeId allocate();
+    void release(NodeId block);
+
+    // Returns every committed page to the OS and rewinds the bump pointer if
+    // no block is in use. No thread may allocate meanwhile, so call it
+    // between searches. Returns false, doing nothing, if blocks are in use.
+    bool trim();
+
+    int get_block_size() const;
+    size_t get_capacity() const; // Can be below the capacity asked for, see above
+    size_t blocks_in_use() const;
+    size_t bytes_touched() const; // Upper bound on resident memory
+
+    private:
+    size_t capacity;
+    int block_size;
+    std::atomic<size_t> top; // Next never-used id
+    std::atomic<size_t> in_use;
+    std::atomic<NodeId> free_head;
+    std::mutex free_mtx;
+    std::atomic<size_t> committed; // Ids below are readable and writable
+    std::mutex commit_mtx;
+
+    bool reserve_all();
+    void unreserve_all();
+    void commit(size_t end);
+
+    template<typename T>
+    static T* reserve(size_t count);
+    template<typename T>
+    static void unreserve(T* array, size_t count);
+    template<typename T>
+    static bool commit(T* array, size_t begin, size_t end);
+    template<typename T>
+    static void decommit(T* array, size_t count);
+};
+
+template<typename T>
+T* NodeArena::reserve(size_t count){
+    // PROT_NONE address space is not charged against the commit limit, so
+    // this holds under strict overcommit accounting too; nullptr on failure
+    void* memory = mmap(nullptr, count * sizeof(T), PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<T*>(memory);
+}
+
+template<typename T>
+void NodeArena::unreserve(T* array, size_t count){
+    munmap(array, count * sizeof(T));
+}
+
+template<typename T>
+bool NodeArena::commit(T* array, size_t begin, size_t end){
+    return mprotect(array + begin, (end - begin) * sizeof(T), PROT_READ | PROT_WRITE) == 0;
+}
+
+template<typename T>
+void NodeArena::decommit(T* array, size_t count){
+    // Anonymous pages read back as zero after MADV_DONTNEED
+    madvise(array, count * sizeof(T), MADV_DONTNEED);
+}
+
+inline NodeArena::NodeArena(size_t capacity, int block_size)
+    : capacity(capacity), block_size(block_size), top(block_size), in_use(0), free_head(NULL_NODE), committed(0) {
+    while (!reserve_all()){
+        if (this->capacity / 2 < MIN_CAPACITY) {
+            throw std::bad_alloc();
+        }
+        this->capacity /= 2;
+    }
+    // The first block is never handed out so that id 0 can mean "no node",
+    // but it is read as one, so it is committed from the start
+    try {
+        commit(block_size);
+    } catch (...) {
+        unreserve_all();
+        throw;
+    }
+}
+
+inline NodeArena::~NodeArena(){
+    unreserve_all();
+}
+
+// Reserves every array for capacity ids; all or none
+inline bool NodeArena::reserve_all(){
+    visits = reserve<std::atomic<int32_t>>(capacity);
+    W = reserve<std::atomic<float>>(capacity);
+    virtual_loss = reserve<std::atomic<int16_t>>(capacity);
+    first_child = reserve<std::atomic<NodeId>>(capacity);
+    flags = reserve<std::atomic<uint8_t>>(capacity);
+    num_children = reserve<uint8_t>(capacity);
+    prior = reserve<float>(capacity);
+    if (visits && W && virtual_loss && first_child && flags && num_children && prior) {
+        return true;
+    }
+    unreserve_all();
+    return false;
+}
+
+inline void NodeArena::unreserve_all(){
+    if (visits) unreserve(visits, capacity);
+    if (W) unreserve(W, capacity);
+    if (virtual_loss) unreserve(virtual_loss, capacity);
+    if (first_child) unreserve(first_child, capacity);
+    if (flags) unreserve(flags, capacity);
+    if (num_children) unreserve(num_children, capacity);
+    if (prior) unreserve(prior, capacity);
+}
+
+// Opens ids up to at least end, a COMMIT_STEP at a time, for every array
+inline void NodeArena::commit(size_t end){
+    std::lock_guard<std::mutex> lock(commit_mtx);
+    size_t begin = committed.load(std::memory_order_relaxed);
+    if (end <= begin) {
+        return;
+    }
+    end = std::min(capacity, (end + COMMIT_STEP - 1) / COMMIT_STEP * COMMIT_STEP);
+    // A failure part way leaves committed as it was; a retry redoes the lot
+    bool ok = commit(visits, begin, end) && commit(W, begin, end) && commit(virtual_loss, begin, end)
+        && commit(first_child, begin, end) && commit(flags, begin, end) && commit(num_children, begin, end)
+        && commit(prior, begin, end);
+    if (!ok) {
+        throw std::bad_alloc();
+    }
+    committed.store(end, std::memory_order_release);
+}
+
+inline NodeId NodeArena::allocate(){
+    if (free_head.load(std::memory_order_relaxed) != NULL_NODE) {
+        std::lock_guard<std::mutex> lock(free_mtx);
+        NodeId block = free_head.load(std::memory_order_relaxed);
+        if (block != NULL_NODE) {
+            free_head.store(first_child[block].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            in_use.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+    }
+    size_t block = top.fetch_add(block_size, std::memory_order_relaxed);
+    if (block + block_size > capacity) {
+        throw std::bad_alloc();
+    }
+    if (block + block_size > committed.load(std::memory_order_acquire)) {
+        commit(block + block_size);
+    }
+    in_use.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<NodeId>(block);
+}
+
+inline void NodeArena::release(NodeId block){
+    if (block == NULL_NODE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(free_mtx);
+    first_child[block].store(free_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    free_head.store(block, std::memory_order_relaxed);
+    in_use.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline bool NodeArena::trim(){
+    std::lock_guard<std::mutex> lock(free_mtx);
+    if (in_use.load(std::memory_order_relaxed) != 0) {
+        return false;
+    }
+    size_t used = std::min(top.load(std::memory_order_relaxed), capacity);
+    decommit(visits, used);
+    decommit(W, used);
+    decommit(virtual_loss, used);
+    decommit(first_child, used);
+    decommit(flags, used);
+    decommit(num_children, used);
+    decommit(prior, used);
+    top.store(block_size, std::memory_order_relaxed);
+    free_head.store(NULL_NODE, std::memory_order_relaxed);
+    return true;
+}
+
+inline int NodeArena::get_block_size() const {
+    return block_size;
+}
+
+inline size_t NodeArena::get_capacity() const {
+    return capacity;
+}
+
+inline size_t NodeArena::blocks_in_use() const {
+    return in_use.load(std::memory_order_relaxed);
+}
+
+inline size_t NodeArena::bytes_touched() const {
+    return std::min(top.load(std::memory_order_relaxed), capacity) * BYTES_PER_NODE;
+}
+
+#endif // NODE_ARENA_HPP
@@ -0,0 +1,220 @@
+#ifndef PLAYOUT_KERNEL_HPP
+#define PLAYOUT_KERNEL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "game_dynamics/connect4.hpp"
+#include "rng.hpp"
+
+// How playouts pick their moves
+enum class RolloutPolicy {
+    Uniform, // Uniformly random over the legal moves
+    // A move that wins at once if there is one, else uniform over the moves
+    // that leave the opponent no immediate win (a block when it threatens
+    // one), else uniform
+    Tactical
+};
+
+// Lane-parallel random playouts. A game with a kernel specialises this with
+// available = true and
+//   static void play(const Game* positions, int count, int per_position, Rng& rng, RewardT* out,
+//                    RolloutPolicy policy);
+// which plays per_position playouts under policy from each position,
+// terminal ones included, and writes each position's mean reward to out.
+// MCTSNode falls back to stepping a Game copy move by move without one.
+template <typename Game>
+struct PlayoutKernel {
+    static constexpr bool available = false;
+};
+
+// 8x8 Connect4 on 64-bit bitboards, bit 8 * col + row, with one board for
+// the side to move and one for the other, swapped every ply. Playouts run
+// LANES at a time in lockstep and every step of a ply is a branch-free loop
+// over the lanes, which the compiler vectorises: a xoshiro256** draw per
+// lane, a column pick that redraws only the lanes that hit a full column,
+// the drop, and a shift-and-mask test for four in a row. Lanes may start
+// from different positions, so one call covers the playouts of one leaf or
+// of a whole batch of leaves. The tactical policy adds a threat map per side
+// and ply, forces the lanes that have a win and narrows the column pick of
+// the rest to the safe columns.
+template <>
+struct PlayoutKernel<Connect4<8>> {
+    using Game = Connect4<8>;
+    using RewardT = Game::RewardT;
+    static constexpr bool available = true;
+    static constexpr int LANES = 16;
+
+    static void play(const Game* positions, int count, int per_position, Rng& rng, RewardT* out,
+                     RolloutPolicy policy = RolloutPolicy::Uniform){
+        for (int i = 0; i < count; i++){
+            out[i] = RewardT{0, 0};
+        }
+        int total = count * per_position;
+        for (int first = 0; first < total; first += LANES){
+            int lanes = std::min(LANES, total - first);
+            int64_t outcome[LANES];
+            if (policy == RolloutPolicy::Tactical) {
+                play_lanes<true>(positions, first, per_position, lanes, rng, outcome);
+            } else {
+                play_lanes<false>(positions, first, per_position, lanes, rng, outcome);
+            }
+            for (int l = 0; l < lanes; l++){
+                int i = (first + l) / per_position;
+                double reward = positions[i].player == Game::Player0 ? outcome[l] : -outcome[l];
+                out[i][0] += reward;
+                out[i][1] -= reward;
+            }
+        }
+        for (int i = 0; i < count; i++){
+            out[i][0] /= per_position;
+            out[i][1] /= per_position;
+        }
+    }
+
+    private:
+    static constexpr uint64_t ROW0 = 0x0101010101010101ULL;
+    static constexpr uint64_t ROW7 = ROW0 << 7;
+    static constexpr uint64_t FULL = ~0ULL;
+
+    static uint64_t bitboard(const Game& game, int player){
+        static_assert(sizeof(game.state[0]) == sizeof(uint64_t), "one byte per column");
+        uint64_t board;
+        memcpy(&board, game.state[player], sizeof(board));
+        return board;
+    }
+
+    // Nonzero if board holds four in a row. Each direction pairs cells one
+    // step apart, then pairs of pairs two steps apart; the masks drop the
+    // pairs a shift carried across the top or bottom of a column.
+    static uint64_t four_in_a_row(uint64_t board){
+        uint64_t vertical = board & (board >> 1) & ~ROW7;
+        vertical &= (vertical >> 2) & ~(ROW7 | (ROW7 >> 1));
+        uint64_t horizontal = board & (board >> 8);
+        horizontal &= horizontal >> 16;
+        uint64_t diagonal = board & (board >> 9) & ~ROW7;
+        diagonal &= (diagonal >> 18) & ~(ROW7 | (ROW7 >> 1));
+        uint64_t anti_diagonal = board & (board >> 7) & ~ROW0;
+        anti_diagonal &= (anti_diagonal >> 14) & ~(ROW0 | (ROW0 << 1));
+        return vertical | horizontal | diagonal | anti_diagonal;
+    }
+
+    // Every cell that would give board four in a row if it held a stone:
+    // the bitboard form of HF_Net::would_create_win, for all cells at once.
+    // Per direction, up and down move the stones one step along it, masking
+    // the ones a shift would carry across the top or bottom of a column.
+    static uint64_t winning_cells(uint64_t board){
+        uint64_t cells = line_threats(board, 1, ~ROW7, ~ROW7);
+        cells |= line_threats(board, 8, FULL, FULL);
+        cells |= line_threats(board, 9, ~ROW7, ~ROW7);
+        cells |= line_threats(board, 7, ~ROW0, ~ROW0);
+        return cells;
+    }
+
+    // Cells completing a line of four along step: three stones after the
+    // cell, two after and one before, one after and two before, or three before
+    static uint64_t line_threats(uint64_t board, int step, uint64_t up_keep, uint64_t down_keep){
+        uint64_t up1 = (board & up_keep) << step;
+        uint64_t up2 = (up1 & up_keep) << step;
+        uint64_t up3 = (up2 & up_keep) << step;
+        uint64_t down1 = (board >> step) & down_keep;
+        uint64_t down2 = (down1 >> step) & down_keep;
+        uint64_t down3 = (down2 >> step) & down_keep;
+        return (down1 & down2 & down3) | (up1 & down1 & down2) | (up2 & up1 & down1) | (up3 & up2 & up1);
+    }
+
+    static uint64_t rotl(uint64_t x, int k){
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // Playouts first .. first + lanes of the positions' playouts, each
+    // position's per_position in turn. outcome is +1 where the side to move
+    // at the start wins, -1 where it loses and 0 for a draw.
+    template <bool TACTICAL>
+    static void play_lanes(const Game* positions, int first, int per_position, int lanes, Rng& rng, int64_t* outcome){
+        uint64_t me[LANES], them[LANES], done[LANES];
+        uint64_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+        for (int l = 0; l < LANES; l++){
+            me[l] = them[l] = 0;
+            done[l] = FULL;
+            outcome[l] = 0;
+            s0[l] = rng.next();
+            s1[l] = rng.next();
+            s2[l] = rng.next();
+            s3[l] = rng.next();
+            if (l >= lanes) continue;
+            const Game& position = positions[(first + l) / per_position];
+            me[l] = bitboard(position, position.player);
+            them[l] = bitboard(position, position.player ^ 1);
+            // The previous move may already have ended the game
+            if (four_in_a_row(them[l])) {
+                outcome[l] = -1;
+            } else if ((me[l] | them[l]) != FULL) {
+                done[l] = 0;
+            }
+        }
+        for (int64_t sign = 1; ; sign = -sign){
+            // Drop a stone in a uniformly random column that has room
+            uint64_t move[LANES], need[LANES], allowed[LANES];
+            for (int l = 0; l < LANES; l++){
+                move[l] = 0;
+                need[l] = ~done[l];
+                allowed[l] = FULL;
+                if constexpr (TACTICAL) {
+                    // The lowest empty cell of every column; keeping row 7
+                    // out of the add stops a full column carrying into the next
+                    uint64_t occupied = me[l] | them[l];
+                    uint64_t playable = ((occupied & ~ROW7) + ROW0) & ~occupied;
+                    uint64_t wins = winning_cells(me[l]) & playable;
+                    uint64_t threats = winning_cells(them[l]);
+                    uint64_t blocks = threats & playable;
+                    // Not under one of the opponent's winning cells, the only
+                    // block if there is one, nothing if there are two
+                    uint64_t safe = playable & ~((threats >> 1) & ~ROW7);
+                    safe &= blocks | (0 - static_cast<uint64_t>(blocks == 0));
+                    safe &= 0 - static_cast<uint64_t>((blocks & (blocks - 1)) == 0);
+                    allowed[l] = safe | (0 - static_cast<uint64_t>(safe == 0));
+                    move[l] = wins & (0 - wins) & need[l];
+                    need[l] &= 0 - static_cast<uint64_t>(wins == 0);
+                }
+            }
+            for (uint64_t pending = 1; pending != 0; ){
+                pending = 0;
+                for (int l = 0; l < LANES; l++){
+                    uint64_t draw = rotl(s1[l] * 5, 7) * 9;
+                    uint64_t t = s1[l] << 17;
+                    s2[l] ^= s0[l];
+                    s3[l] ^= s1[l];
+                    s1[l] ^= s2[l];
+                    s0[l] ^= s3[l];
+                    s2[l] ^= t;
+                    s3[l] = rotl(s3[l], 45);
+
+                    uint64_t shift = (draw >> 61) * 8;
+                    uint64_t column = ((me[l] | them[l]) >> shift) & 0xFF;
+                    // Columns fill from the bottom, so this is the lowest empty cell, or 0 if full
+                    uint64_t drop = (((column + 1) & 0xFF) << shift) & allowed[l];
+                    uint64_t take = need[l] & (0 - static_cast<uint64_t>(drop != 0));
+                    move[l] |= drop & take;
+                    need[l] &= ~take;
+                    pending |= need[l];
+                }
+            }
+            uint64_t active = 0;
+            for (int l = 0; l < LANES; l++){
+                uint64_t mine = me[l] | move[l];
+                uint64_t won = ~done[l] & (0 - static_cast<uint64_t>(four_in_a_row(mine) != 0));
+                uint64_t drawn = ~done[l] & (0 - static_cast<uint64_t>((mine | them[l]) == FULL));
+                outcome[l] = static_cast<int64_t>((won & static_cast<uint64_t>(sign)) | (~won & static_cast<uint64_t>(outcome[l])));
+                done[l] |= won | drawn;
+                me[l] = them[l];
+                them[l] = mine;
+                active |= ~done[l];
+            }
+            if (active == 0) break;
+        }
+    }
+};
+
+#endif // PLAYOUT_KERNEL_HPP
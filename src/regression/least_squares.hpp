@@ -0,0 +1,152 @@
+#ifndef LEAST_SQUARES_HPP
+#define LEAST_SQUARES_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../replay_buffer.hpp"
+
+// The normal equations X^T X w = X^T y of a linear model without an
+// intercept, the fit solver.ipynb made with LinearRegression(fit_intercept
+// = false). Rows are added one at a time, so a dataset of any size streams
+// through in one pass; only the upper triangle of X^T X is accumulated.
+struct NormalEquations {
+    int n;
+    std::vector<double> xtx; // n x n, row-major
+    std::vector<double> xty;
+    double yty = 0;
+    int64_t count = 0;
+
+    explicit NormalEquations(int n) : n(n), xtx(n * n, 0.0), xty(n, 0.0) {}
+
+    void add(const float* x, double y){
+        for (int i = 0; i < n; i++){
+            double xi = x[i];
+            double* row = &xtx[i * n];
+            for (int j = i; j < n; j++){
+                row[j] += xi * x[j];
+            }
+            xty[i] += xi * y;
+        }
+        yty += y * y;
+        count++;
+    }
+
+    void merge(const NormalEquations& other){
+        for (int i = 0; i < n * n; i++){
+            xtx[i] += other.xtx[i];
+        }
+        for (int i = 0; i < n; i++){
+            xty[i] += other.xty[i];
+        }
+        yty += other.yty;
+        count += other.count;
+    }
+
+    // The weights minimising squared error plus ridge * count * |w|^2, by
+    // Cholesky. A small ridge keeps a feature that never fires, a column of
+    // zeros, at weight 0 instead of making the system singular.
+    std::vector<double> solve(double ridge) const {
+        std::vector<double> l(n * n, 0.0);
+        for (int i = 0; i < n; i++){
+            for (int j = 0; j <= i; j++){
+                double sum = xtx[j * n + i] + (i == j ? ridge * std::max<int64_t>(count, 1) : 0.0);
+                for (int k = 0; k < j; k++){
+                    sum -= l[i * n + k] * l[j * n + k];
+                }
+                if (i == j) {
+                    if (sum <= 0) throw std::runtime_error("normal equations are singular; raise the ridge");
+                    l[i * n + i] = std::sqrt(sum);
+                } else {
+                    l[i * n + j] = sum / l[j * n + j];
+                }
+            }
+        }
+        std::vector<double> w(n);
+        for (int i = 0; i < n; i++){
+            double sum = xty[i];
+            for (int k = 0; k < i; k++){
+                sum -= l[i * n + k] * w[k];
+            }
+            w[i] = sum / l[i * n + i];
+        }
+        for (int i = n - 1; i >= 0; i--){
+            double sum = w[i];
+            for (int k = i + 1; k < n; k++){
+                sum -= l[k * n + i] * w[k];
+            }
+            w[i] = sum / l[i * n + i];
+        }
+        return w;
+    }
+
+    // Mean squared error of w over the added rows, from the sums alone
+    double mse(const double* w) const {
+        double quadratic = 0;
+        for (int i = 0; i < n; i++){
+            for (int j = 0; j < n; j++){
+                quadratic += w[i] * w[j] * xtx[std::min(i, j) * n + std::max(i, j)];
+            }
+        }
+        double linear = 0;
+        for (int i = 0; i < n; i++){
+            linear += w[i] * xty[i];
+        }
+        return count > 0 ? (yty - 2 * linear + quadratic) / count : 0;
+    }
+};
+
+// Normal equations over every record of the shards, features against
+// outcome, on num_threads threads. The records are dealt out in chunks
+// that each thread accumulates into its own NormalEquations, merged at the
+// end, so the threads share nothing while they run.
+inline NormalEquations accumulate(const std::vector<const ReplayReader*>& shards, int num_threads){
+    if (shards.empty()) throw std::runtime_error("no shards to fit");
+    int n = shards[0]->format().num_features;
+    for (const ReplayReader* shard : shards){
+        if (static_cast<int>(shard->format().num_features) != n) {
+            throw std::runtime_error("shards have different feature counts");
+        }
+    }
+    constexpr size_t CHUNK = 1 << 14;
+    struct Chunk {
+        const ReplayReader* shard;
+        size_t begin, end;
+    };
+    std::vector<Chunk> chunks;
+    for (const ReplayReader* shard : shards){
+        for (size_t begin = 0; begin < shard->size(); begin += CHUNK){
+            chunks.push_back({shard, begin, std::min(shard->size(), begin + CHUNK)});
+        }
+    }
+
+    num_threads = std::max(1, num_threads);
+    std::vector<NormalEquations> partial(num_threads, NormalEquations(n));
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++){
+        threads.emplace_back([&, t]() {
+            for (size_t c = next++; c < chunks.size(); c = next++){
+                const Chunk& chunk = chunks[c];
+                for (size_t i = chunk.begin; i < chunk.end; i++){
+                    ReplayRecord record = (*chunk.shard)[i];
+                    partial[t].add(record.features(), record.outcome());
+                }
+            }
+        });
+    }
+    for (auto& thread : threads){
+        thread.join();
+    }
+    for (int t = 1; t < num_threads; t++){
+        partial[0].merge(partial[t]);
+    }
+    return partial[0];
+}
+
+#endif // LEAST_SQUARES_HPP
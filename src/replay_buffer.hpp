@@ -0,0 +1,309 @@
+#ifndef REPLAY_BUFFER_HPP
+#define REPLAY_BUFFER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Self-play training data as fixed-size binary records. Each writer thread
+// owns a file of its own (a shard): a ReplayHeader, then records back to
+// back, so a reader maps the file and finds record i at
+// sizeof(ReplayHeader) + i * record_size. A record is, in host byte order,
+//   float    features[num_features]  HF_Net::fill_evals of the position
+//   int8_t   outcome                 Final result for player 0: 1, 0 or -1
+//   uint8_t  player                  Side to move
+//   uint16_t ply                     Moves played before the position
+//   uint8_t  board[board_bytes]      With HAS_BOARD: the Game's state array
+//   uint32_t visits[num_actions]     With HAS_VISITS: root visits per action,
+//                                    indexed by ActionT, 4-byte aligned
+struct ReplayFormat {
+    static constexpr uint32_t HAS_BOARD = 1;
+    static constexpr uint32_t HAS_VISITS = 2;
+
+    uint32_t num_features = 0;
+    uint32_t board_bytes = 0;
+    uint32_t num_actions = 0;
+    uint32_t flags = 0;
+
+    uint32_t board_offset() const {
+        return num_features * sizeof(float) + 4;
+    }
+
+    uint32_t visits_offset() const {
+        uint32_t end = board_offset() + ((flags & HAS_BOARD) ? board_bytes : 0);
+        return (end + 3) & ~3u;
+    }
+
+    uint32_t record_size() const {
+        return visits_offset() + ((flags & HAS_VISITS) ? num_actions * sizeof(uint32_t) : 0);
+    }
+
+    bool operator==(const ReplayFormat& other) const {
+        return num_features == other.num_features && board_bytes == other.board_bytes &&
+               num_actions == other.num_actions && flags == other.flags;
+    }
+};
+
+struct ReplayHeader {
+    static constexpr char MAGIC[8] = {'M', 'C', 'T', 'S', 'R', 'P', 'L', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    ReplayFormat format;
+
+    static ReplayHeader make(const ReplayFormat& format){
+        ReplayHeader header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.record_size = format.record_size();
+        header.format = format;
+        return header;
+    }
+
+    bool valid() const {
+        return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && version == VERSION &&
+               record_size == format.record_size();
+    }
+};
+static_assert(sizeof(ReplayHeader) % 4 == 0, "records after the header stay 4-byte aligned");
+
+// One position to write; board and visits are read only when the format has them
+struct ReplaySample {
+    const double* features = nullptr; // num_features, narrowed to float
+    int outcome = 0;
+    int player = 0;
+    int ply = 0;
+    const void* board = nullptr;      // board_bytes
+    const uint32_t* visits = nullptr; // num_actions
+};
+
+// Appends records to one shard through a buffer that goes to the file only
+// when full, on flush() or on destruction, so a self-play thread makes one
+// write per buffer_bytes of data. Not thread-safe: give each thread its own.
+// An existing shard must have the same format; a partial record left at its
+// end by a crash is cut off before appending.
+class ReplayWriter {
+    public:
+    static constexpr size_t DEFAULT_BUFFER_BYTES = 1 << 20;
+
+    ReplayWriter(const std::string& path, const ReplayFormat& format, size_t buffer_bytes = DEFAULT_BUFFER_BYTES)
+        : path(path), format(format), record_size(format.record_size()) {
+        buffer.reserve(std::max<size_t>(buffer_bytes, record_size));
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            fail();
+        }
+        ReplayHeader header = ReplayHeader::make(format);
+        if (st.st_size == 0) {
+            try {
+                write_all(&header, sizeof(header));
+            } catch (...) {
+                close(fd);
+                throw;
+            }
+            return;
+        }
+        ReplayHeader existing;
+        if (pread(fd, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+            !existing.valid() || !(existing.format == format)) {
+            close(fd);
+            throw std::runtime_error(path + ": not a replay shard of this format");
+        }
+        off_t whole = sizeof(header) + (st.st_size - sizeof(header)) / record_size * record_size;
+        if (whole != st.st_size && ftruncate(fd, whole) != 0) {
+            fail();
+        }
+    }
+
+    ~ReplayWriter(){
+        try {
+            flush();
+        } catch (const std::exception& e) {
+            std::cerr << "Error: lost buffered replay records: " << e.what() << std::endl;
+        }
+        close(fd);
+    }
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    void add(const ReplaySample& sample){
+        if (buffer.size() + record_size > buffer.capacity()) {
+            flush();
+        }
+        size_t start = buffer.size();
+        buffer.resize(start + record_size);
+        uint8_t* record = buffer.data() + start;
+        memset(record, 0, record_size);
+        float* features = reinterpret_cast<float*>(record);
+        for (uint32_t i = 0; i < format.num_features; i++){
+            features[i] = static_cast<float>(sample.features[i]);
+        }
+        uint8_t* tail = record + format.num_features * sizeof(float);
+        tail[0] = static_cast<uint8_t>(static_cast<int8_t>(sample.outcome));
+        tail[1] = static_cast<uint8_t>(sample.player);
+        uint16_t ply = static_cast<uint16_t>(sample.ply);
+        memcpy(tail + 2, &ply, sizeof(ply));
+        if (format.flags & ReplayFormat::HAS_BOARD) {
+            memcpy(record + format.board_offset(), sample.board, format.board_bytes);
+        }
+        if (format.flags & ReplayFormat::HAS_VISITS) {
+            memcpy(record + format.visits_offset(), sample.visits, format.num_actions * sizeof(uint32_t));
+        }
+        added++;
+    }
+
+    // Writes the buffered records to the file
+    void flush(){
+        if (buffer.empty()) return;
+        write_all(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    // Records added through this writer, buffered ones included
+    int64_t records() const {
+        return added;
+    }
+
+    private:
+    std::string path;
+    ReplayFormat format;
+    size_t record_size;
+    std::vector<uint8_t> buffer;
+    int fd = -1;
+    int64_t added = 0;
+
+    void write_all(const void* data, size_t size){
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0){
+            ssize_t written = write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+            bytes += written;
+            size -= written;
+        }
+    }
+
+    [[noreturn]] void fail(){
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+};
+
+// A record in a mapped shard
+class ReplayRecord {
+    public:
+    ReplayRecord(const uint8_t* data, const ReplayFormat& format) : data(data), format(&format) {}
+
+    const float* features() const {
+        return reinterpret_cast<const float*>(data);
+    }
+
+    int outcome() const {
+        return static_cast<int8_t>(data[format->num_features * sizeof(float)]);
+    }
+
+    int player() const {
+        return data[format->num_features * sizeof(float) + 1];
+    }
+
+    int ply() const {
+        uint16_t ply;
+        memcpy(&ply, data + format->num_features * sizeof(float) + 2, sizeof(ply));
+        return ply;
+    }
+
+    // nullptr when the shard has no boards
+    const uint8_t* board() const {
+        return (format->flags & ReplayFormat::HAS_BOARD) ? data + format->board_offset() : nullptr;
+    }
+
+    // nullptr when the shard has no visit counts
+    const uint32_t* visits() const {
+        return (format->flags & ReplayFormat::HAS_VISITS)
+            ? reinterpret_cast<const uint32_t*>(data + format->visits_offset()) : nullptr;
+    }
+
+    private:
+    const uint8_t* data;
+    const ReplayFormat* format;
+};
+
+// Maps a shard read-only. Records a writer still holds in its buffer, or
+// appends after the mapping, are not seen; a partial record at the end is
+// ignored.
+class ReplayReader {
+    public:
+    explicit ReplayReader(const std::string& path){
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        length = st.st_size;
+        void* memory = length >= sizeof(ReplayHeader)
+            ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (memory == MAP_FAILED || !static_cast<const ReplayHeader*>(memory)->valid()) {
+            if (memory != MAP_FAILED) munmap(memory, length);
+            throw std::runtime_error(path + ": not a replay shard");
+        }
+        // Records are read in order by fitters and dumps
+        madvise(memory, length, MADV_SEQUENTIAL);
+        base = static_cast<const uint8_t*>(memory);
+        header = *static_cast<const ReplayHeader*>(memory);
+        count = (length - sizeof(ReplayHeader)) / header.record_size;
+    }
+
+    ~ReplayReader(){
+        munmap(const_cast<uint8_t*>(base), length);
+    }
+
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    const ReplayFormat& format() const {
+        return header.format;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    ReplayRecord operator[](size_t i) const {
+        return ReplayRecord(base + sizeof(ReplayHeader) + i * header.record_size, header.format);
+    }
+
+    private:
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    ReplayHeader header;
+};
+
+#endif // REPLAY_BUFFER_HPP
@@ -0,0 +1,79 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+
+// xoshiro256** (Blackman and Vigna): a small, fast generator for rollouts
+// and move sampling. Each thread owns its own, so nothing is shared or
+// locked, and a seed fixes the whole sequence. Seeds are expanded through
+// splitmix64, so any 64-bit value gives a well-mixed state.
+class Rng {
+    public:
+    static constexpr uint64_t DEFAULT_SEED = 1;
+
+    explicit Rng(uint64_t seed = DEFAULT_SEED){
+        for (uint64_t& word : s) {
+            word = splitmix64(seed);
+        }
+    }
+
+    uint64_t next(){
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound), bound > 0. Lemire's multiply-shift, rejecting
+    // the few draws that would bias it the way % does.
+    uint32_t below(uint32_t bound){
+        uint64_t product = (next() >> 32) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = -bound % bound;
+            while (low < threshold) {
+                product = (next() >> 32) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    // Uniform in [0, 1)
+    double uniform(){
+        return static_cast<double>(next() >> 11) * 0x1.0p-53;
+    }
+
+    // A generator for another thread, seeded from this one's sequence
+    Rng split(){
+        return Rng(next());
+    }
+
+    // Seed of stream index under master, e.g. one per self-play game, so a
+    // run's streams do not depend on which thread picks up which index
+    static uint64_t stream_seed(uint64_t master, uint64_t index){
+        uint64_t x = master ^ (index * 0xD1B54A32D192ED03ULL);
+        return splitmix64(x);
+    }
+
+    private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k){
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t splitmix64(uint64_t& x){
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif // RNG_HPP
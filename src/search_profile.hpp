@@ -0,0 +1,171 @@
+#ifndef SEARCH_PROFILE_HPP
+#define SEARCH_PROFILE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#if defined(MCTS_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+// Where a search iteration spends its time, by phase. Built with
+// MCTS_PROFILE defined (make PROFILE=1), every PhaseTimer counts one call
+// and the cycles it was alive into counters of its own thread. Without it
+// a PhaseTimer is an empty object and no counting code is compiled in.
+//
+// A SearchProfile collects the counters of every thread of one search:
+// each thread that runs under a ProfileScope for it adds its counters when
+// the scope ends. Counters outside any scope are dropped.
+enum class SearchPhase {
+    Select,   // ucb_select: scoring a node's children
+    Allocate, // NodeArena::allocate for a new root or children block
+    Evaluate, // HF_Net::forward and forward_batch
+    Rollout,  // random_rollouts
+    Backup    // backup along the descent's path
+};
+
+constexpr int NUM_SEARCH_PHASES = 5;
+
+// Calls and cycles per phase, from one thread or summed over several
+struct PhaseCounts {
+    uint64_t calls[NUM_SEARCH_PHASES] = {};
+    uint64_t cycles[NUM_SEARCH_PHASES] = {};
+
+    void merge(const PhaseCounts& other){
+        for (int i = 0; i < NUM_SEARCH_PHASES; i++){
+            calls[i] += other.calls[i];
+            cycles[i] += other.cycles[i];
+        }
+    }
+
+    uint64_t total_cycles() const {
+        uint64_t total = 0;
+        for (int i = 0; i < NUM_SEARCH_PHASES; i++){
+            total += cycles[i];
+        }
+        return total;
+    }
+
+    // One line per phase: calls, cycles per call and share of the timed cycles
+    void print(FILE* out, const char* label) const {
+        static const char* NAMES[NUM_SEARCH_PHASES] = {"select", "allocate", "evaluate", "rollout", "backup"};
+        uint64_t total = total_cycles();
+        fprintf(out, "%s: %.1fM cycles timed\n", label, total / 1e6);
+        for (int i = 0; i < NUM_SEARCH_PHASES; i++){
+            fprintf(out, "  %-9s %12llu calls %10.1f cycles/call %6.1f%%\n", NAMES[i],
+                    static_cast<unsigned long long>(calls[i]), calls[i] == 0 ? 0.0 : double(cycles[i]) / calls[i],
+                    total == 0 ? 0.0 : 100.0 * cycles[i] / total);
+        }
+    }
+};
+
+class SearchProfile {
+    public:
+#ifdef MCTS_PROFILE
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    SearchProfile() = default;
+    SearchProfile(const SearchProfile&) = delete;
+    SearchProfile& operator=(const SearchProfile&) = delete;
+
+    void add(const PhaseCounts& counts){
+        std::lock_guard<std::mutex> lock(mutex);
+        totals.merge(counts);
+    }
+
+    // The counters added so far; complete once every scope for it has ended
+    PhaseCounts counts() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return totals;
+    }
+
+    // The profile this thread's counters go to, nullptr outside a scope
+    static SearchProfile* active(){
+        return ENABLED ? current : nullptr;
+    }
+
+    // Cycle counter: the TSC where there is one, else steady_clock ns
+    static uint64_t now(){
+#if defined(MCTS_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // This thread's counters since its outermost scope began
+    static inline thread_local PhaseCounts thread_counts;
+
+    private:
+    friend class ProfileScope;
+    static inline thread_local SearchProfile* current = nullptr;
+
+    mutable std::mutex mutex;
+    PhaseCounts totals;
+};
+
+#ifdef MCTS_PROFILE
+// Sends this thread's counters to profile for its lifetime; a null profile
+// collects nothing. Scopes nest: an inner one keeps the outer one's
+// profile, and only the outermost adds the counters when it ends. Threads
+// a search starts take SearchProfile::active() of the thread starting them.
+class ProfileScope {
+    public:
+    explicit ProfileScope(SearchProfile* profile){
+        if (profile != nullptr && SearchProfile::current == nullptr) {
+            SearchProfile::current = profile;
+            SearchProfile::thread_counts = PhaseCounts();
+            outermost = true;
+        }
+    }
+
+    ~ProfileScope(){
+        if (!outermost) return;
+        SearchProfile::current->add(SearchProfile::thread_counts);
+        SearchProfile::current = nullptr;
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+    bool outermost = false;
+};
+
+// Counts one call of phase and the cycles until it goes out of scope
+class PhaseTimer {
+    public:
+    explicit PhaseTimer(SearchPhase phase) : phase(static_cast<int>(phase)), start(SearchProfile::now()) {}
+
+    ~PhaseTimer(){
+        PhaseCounts& counts = SearchProfile::thread_counts;
+        counts.calls[phase]++;
+        counts.cycles[phase] += SearchProfile::now() - start;
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+    int phase;
+    uint64_t start;
+};
+#else
+// Compiled out: empty objects the optimiser drops
+class ProfileScope {
+    public:
+    explicit ProfileScope(SearchProfile*) {}
+};
+
+class PhaseTimer {
+    public:
+    explicit PhaseTimer(SearchPhase) {}
+};
+#endif
+
+#endif // SEARCH_PROFILE_HPP
@@ -0,0 +1,183 @@
+#ifndef SEARCH_SERVICE_HPP
+#define SEARCH_SERVICE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mcts.hpp"
+
+// The engine as a library object for a host such as a game server. It owns
+// the position and a SearchTree, and one worker thread, started with the
+// service, that runs every search, so a request pays neither thread startup
+// nor a tree rebuild: apply_move() keeps the played move's subtree, given
+// config.reuse_tree. start() returns at once; snapshot() and best_move()
+// may be polled from any thread while the search runs. Tree-parallel
+// search still starts its helper threads per search.
+template <typename Game>
+class SearchService {
+    public:
+    using Node = MCTSNode<Game>;
+    using ActionIdxT = typename Node::ActionIdxT;
+
+    // What the search thinks so far. Moves are action indices, each into the
+    // position the moves before it lead to.
+    struct Snapshot {
+        ActionIdxT best_move = -1; // -1 until a root move has a visit
+        double value = 0;          // Q of best_move for the side to move
+        int visits = 0;            // Root visits, inherited ones included
+        int64_t iterations = 0;    // Run by the current or last search
+        bool proven = false;       // The solver has settled the root
+        std::vector<ActionIdxT> principal_variation; // Most visited line from the root
+    };
+
+    explicit SearchService(const SearchConfig& config) : tree(config) {
+        worker = std::thread([this]() { work(); });
+    }
+
+    SearchService(const SearchConfig& config, Game& position) : SearchService(config) {
+        position.copy_to(game);
+    }
+
+    ~SearchService(){
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    SearchService(const SearchService&) = delete;
+    SearchService& operator=(const SearchService&) = delete;
+
+    // Searches the current position within num_iters and seconds, 0 for no
+    // limit, or until stop(); ends any search still running first. The
+    // search evaluates with the net the calling thread has pinned, else the
+    // one published now.
+    void start(int64_t num_iters = SearchBudget::UNLIMITED, double seconds = 0){
+        stop();
+        std::shared_ptr<typename Node::Net> caller_net = typename Node::NetPin().get();
+        std::lock_guard<std::mutex> lock(mutex);
+        net = std::move(caller_net);
+        budget = std::make_unique<SearchBudget>(num_iters > 0 ? num_iters : SearchBudget::UNLIMITED,
+                                                seconds > 0 ? SearchBudget::after(seconds) : SearchBudget::Clock::time_point::max());
+        // Created here rather than by the search so pollers never race on it
+        if (tree.root.is_null()) {
+            tree.root = Node::new_root(game.get_prev_player(), Node::inherited_flags(tree.config));
+        }
+        pending = true;
+        running = true;
+        wake.notify_one();
+    }
+
+    // Ends the search and waits until the worker is idle
+    void stop(){
+        std::unique_lock<std::mutex> lock(mutex);
+        if (budget) budget->stop();
+        idle.wait(lock, [this]() { return !running; });
+    }
+
+    // Waits for the search to end by its own limits
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return !running; });
+    }
+
+    bool searching(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+    // Plays action_idx from the current position, stopping any search, and
+    // keeps its subtree for the next one
+    void apply_move(ActionIdxT action_idx){
+        stop();
+        std::lock_guard<std::mutex> lock(mutex);
+        game.step(action_idx);
+        tree.advance(action_idx);
+    }
+
+    // Replaces the position, stopping any search, and drops the tree
+    void set_position(Game& position){
+        stop();
+        std::lock_guard<std::mutex> lock(mutex);
+        position.copy_to(game);
+        tree.clear();
+    }
+
+    // The current position
+    void position(Game& out){
+        std::lock_guard<std::mutex> lock(mutex);
+        game.copy_to(out);
+    }
+
+    ActionIdxT best_move(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return tree.root.is_null() ? -1 : tree.root.best_child();
+    }
+
+    // Reads the tree with the same relaxed loads selection uses, so a
+    // snapshot taken mid-search is consistent per node, not across the
+    // line; with max_nodes a line may run through a subtree being pruned.
+    Snapshot snapshot(int max_depth = MAX_PV_LENGTH){
+        std::lock_guard<std::mutex> lock(mutex);
+        Snapshot snap;
+        snap.iterations = budget ? budget->iterations() : 0;
+        Node node = tree.root;
+        if (node.is_null()) return snap;
+        snap.visits = node.n_visits();
+        snap.proven = node.is_proven();
+        for (int depth = 0; depth < max_depth; depth++){
+            ActionIdxT action = node.best_child();
+            if (action == -1) break;
+            node = node.child(action);
+            if (depth == 0) {
+                snap.best_move = action;
+                snap.value = node.get_Q();
+            }
+            snap.principal_variation.push_back(action);
+        }
+        return snap;
+    }
+
+    private:
+    static constexpr int MAX_PV_LENGTH = 16;
+
+    SearchTree<Game> tree;
+    Game game;
+    std::unique_ptr<SearchBudget> budget;
+    std::shared_ptr<typename Node::Net> net; // Pinned by the worker for the search start() asked for
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool pending = false; // A start() the worker has not picked up yet
+    bool running = false; // From start() until that search returns
+    bool quit = false;
+    std::thread worker;
+
+    void work(){
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true){
+            wake.wait(lock, [this]() { return pending || quit; });
+            if (quit) return;
+            pending = false;
+            SearchBudget* current = budget.get();
+            std::shared_ptr<typename Node::Net> pinned = net;
+            lock.unlock();
+            {
+                typename Node::NetPin pin(pinned);
+                tree.search(game, *current);
+            }
+            lock.lock();
+            running = false;
+            idle.notify_all();
+        }
+    }
+};
+
+#endif // SEARCH_SERVICE_HPP
@@ -0,0 +1,181 @@
+#ifndef SELFPLAY_SCHEDULER_HPP
+#define SELFPLAY_SCHEDULER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+struct SchedulerConfig {
+    int num_threads = 0;      // 0 for one per CPU this process may run on
+    int64_t num_games = 0;    // Stop after this many games, 0 for no limit
+    double seconds = 0;       // Start no game after this long, 0 for no limit
+    bool pin_threads = false; // Pin worker t to the t-th CPU of the affinity mask
+};
+
+// What a run did
+struct SchedulerReport {
+    int64_t games = 0;
+    int64_t steals = 0;
+    double seconds = 0;
+    std::vector<int64_t> games_per_thread;
+    int pinned = 0; // Workers pinned to a CPU
+
+    double games_per_second() const {
+        return seconds > 0 ? games / seconds : 0;
+    }
+};
+
+// Runs self-play games, numbered from 0, on a pool of worker threads. Each
+// worker starts with an even share of the game numbers as a range of its
+// own and plays from its front; one that runs dry steals the back half of
+// the largest range left, so a few long games no longer hold up a thread's
+// tail while the others sit idle. A game's number, and so its seed, does
+// not depend on the thread that plays it. Without a game limit the ranges
+// are open-ended and the time limit ends the run; games in progress finish.
+class SelfPlayScheduler {
+    public:
+    explicit SelfPlayScheduler(const SchedulerConfig& config) : config(config) {
+        cpus = allowed_cpus();
+        num_threads = config.num_threads > 0 ? config.num_threads : static_cast<int>(cpus.size());
+        num_threads = std::max(1, num_threads);
+    }
+
+    int threads() const {
+        return num_threads;
+    }
+
+    // Calls play(game, thread) for each game until a limit is reached
+    template <typename Play>
+    SchedulerReport run(Play play){
+        assert(config.num_games > 0 || config.seconds > 0);
+        int64_t total = config.num_games > 0 ? config.num_games : std::numeric_limits<int64_t>::max();
+        ranges = std::vector<std::unique_ptr<Range>>(num_threads);
+        for (int t = 0; t < num_threads; t++){
+            ranges[t] = std::make_unique<Range>();
+            ranges[t]->next = total / num_threads * t + std::min<int64_t>(t, total % num_threads);
+            ranges[t]->end = ranges[t]->next + total / num_threads + (t < total % num_threads);
+        }
+        auto start = Clock::now();
+        Clock::time_point deadline = config.seconds > 0
+            ? start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.seconds))
+            : Clock::time_point::max();
+
+        SchedulerReport report;
+        report.games_per_thread.assign(num_threads, 0);
+        std::atomic<int64_t> steals{0};
+        std::atomic<int> pinned{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < num_threads; t++){
+            workers.emplace_back([&, t]() {
+                if (config.pin_threads && pin(cpus[t % cpus.size()])) pinned++;
+                int64_t game;
+                while (Clock::now() < deadline && take(t, game, steals)){
+                    play(game, t);
+                    report.games_per_thread[t]++;
+                }
+            });
+        }
+        for (auto& worker : workers){
+            worker.join();
+        }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        report.seconds = elapsed.count();
+        report.steals = steals;
+        report.pinned = pinned;
+        for (int64_t games : report.games_per_thread){
+            report.games += games;
+        }
+        return report;
+    }
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    // Game numbers next .. end - 1, still to be played
+    struct Range {
+        std::mutex mutex;
+        int64_t next = 0;
+        int64_t end = 0;
+    };
+
+    SchedulerConfig config;
+    std::vector<int> cpus;
+    int num_threads;
+    std::vector<std::unique_ptr<Range>> ranges;
+
+    // The next game for thread t: its own, else stolen; false once none are left
+    bool take(int t, int64_t& game, std::atomic<int64_t>& steals){
+        while (true){
+            {
+                std::lock_guard<std::mutex> lock(ranges[t]->mutex);
+                if (ranges[t]->next < ranges[t]->end){
+                    game = ranges[t]->next++;
+                    return true;
+                }
+            }
+            int victim = -1;
+            int64_t most = 0;
+            for (int v = 0; v < num_threads; v++){
+                if (v == t) continue;
+                std::lock_guard<std::mutex> lock(ranges[v]->mutex);
+                int64_t left = ranges[v]->end - ranges[v]->next;
+                if (left > most){
+                    victim = v;
+                    most = left;
+                }
+            }
+            if (victim == -1) return false;
+            int64_t from, to;
+            {
+                std::lock_guard<std::mutex> lock(ranges[victim]->mutex);
+                int64_t left = ranges[victim]->end - ranges[victim]->next;
+                // Raced with its owner or another thief; look again
+                if (left == 0) continue;
+                to = ranges[victim]->end;
+                from = to - (left + 1) / 2;
+                ranges[victim]->end = from;
+            }
+            steals++;
+            std::lock_guard<std::mutex> lock(ranges[t]->mutex);
+            ranges[t]->next = from;
+            ranges[t]->end = to;
+        }
+    }
+
+    // The CPUs in this process's affinity mask, in order
+    static std::vector<int> allowed_cpus(){
+        std::vector<int> allowed;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0){
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+                if (CPU_ISSET(cpu, &set)) allowed.push_back(cpu);
+            }
+        }
+        if (allowed.empty()){
+            int count = std::max(1u, std::thread::hardware_concurrency());
+            for (int cpu = 0; cpu < count; cpu++){
+                allowed.push_back(cpu);
+            }
+        }
+        return allowed;
+    }
+
+    static bool pin(int cpu){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+};
+
+#endif // SELFPLAY_SCHEDULER_HPP
@@ -0,0 +1,55 @@
+#ifndef TIME_MANAGER_HPP
+#define TIME_MANAGER_HPP
+
+#include <algorithm>
+
+// Splits one player's game clock across their moves. Each move gets the
+// clock left over the moves still expected, weighted towards the opening,
+// where choices shape the rest of the game, and scaled down as the legal
+// moves run out. A move never takes more than MAX_SHARE of what is left,
+// so a game that runs long does not lose on time.
+template <typename Game>
+class TimeManager {
+    public:
+    // Share of the remaining clock a single move may use
+    static constexpr double MAX_SHARE = 0.25;
+    // Move weight at the start of the game, falling to END_WEIGHT by expected_moves
+    static constexpr double OPENING_WEIGHT = 1.5;
+    static constexpr double END_WEIGHT = 0.5;
+    // The clock is never split over fewer moves than this
+    static constexpr int MIN_MOVES_TO_GO = 4;
+
+    // seconds for the whole game, plus increment added back after every move;
+    // expected_moves is this player's typical number of moves in a game
+    TimeManager(double seconds, int expected_moves, double increment = 0)
+        : clock(seconds), increment(increment), expected_moves(std::max(1, expected_moves)), moves_made(0) {}
+
+    // Seconds to search the position game, where this player is to move
+    double allot(const Game& game) const {
+        if (clock <= 0) return 0;
+        int moves_to_go = std::max(MIN_MOVES_TO_GO, expected_moves - moves_made);
+        double phase = std::min(1.0, static_cast<double>(moves_made) / expected_moves);
+        double weight = OPENING_WEIGHT + (END_WEIGHT - OPENING_WEIGHT) * phase;
+        double branching = static_cast<double>(game.num_actions) / Game::MAX_ACTIONS;
+        double share = clock / moves_to_go * weight * branching + increment;
+        return std::min(share, clock * MAX_SHARE);
+    }
+
+    // Charges a finished move's search time to the clock
+    void spend(double seconds){
+        clock = std::max(0.0, clock - seconds) + increment;
+        moves_made++;
+    }
+
+    double remaining() const {
+        return clock;
+    }
+
+    private:
+    double clock;
+    double increment;
+    int expected_moves;
+    int moves_made;
+};
+
+#endif // TIME_MANAGER_HPP
@@ -0,0 +1,86 @@
+// Fits the HF_Net weights to self-play replay shards by linear least
+// squares, features against the game result, and writes them where
+// chessbot loads them, at startup and between games. Replaces the
+// solver.ipynb round trip.
+//
+// Usage: fit_weights [-o weights_file] [-j threads] [-r ridge] shard...
+// Defaults: -o ../data/weights.txt, -j one per CPU, -r 1e-6.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../game_net/connect4_hf.hpp"
+#include "../regression/least_squares.hpp"
+#include "../replay_buffer.hpp"
+
+using Net = HF_Net<8>;
+
+int main(int argc, char** argv){
+    std::string output = "../data/weights.txt";
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    double ridge = 1e-6;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            ridge = atof(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        fprintf(stderr, "Usage: fit_weights [-o weights_file] [-j threads] [-r ridge] shard...\n");
+        return 1;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<ReplayReader>> readers;
+        std::vector<const ReplayReader*> shards;
+        for (const std::string& path : paths){
+            readers.push_back(std::make_unique<ReplayReader>(path));
+            shards.push_back(readers.back().get());
+        }
+        if (static_cast<int>(shards[0]->format().num_features) != Net::NUM_FEATURES) {
+            throw std::runtime_error("shards do not hold " + std::to_string(Net::NUM_FEATURES) + " features");
+        }
+        NormalEquations equations = accumulate(shards, num_threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (equations.count == 0) throw std::runtime_error("the shards hold no records");
+        std::vector<double> fitted = equations.solve(ridge);
+
+        Net net;
+        // Continue the numbering of the file being replaced, if there is one
+        try {
+            net.load_weights(output);
+        } catch (const std::exception&) {
+        }
+        net.generation++;
+        printf("%lld positions from %zu shards in %.2fs on %d threads (%.1fM positions/s)\n",
+               static_cast<long long>(equations.count), shards.size(), elapsed.count(), num_threads,
+               equations.count / elapsed.count() / 1e6);
+        printf("mean squared error: current weights %.5f, fitted %.5f\n",
+               equations.mse(net.weights), equations.mse(fitted.data()));
+        for (int i = 0; i < Net::NUM_FEATURES; i++){
+            printf("  %2d  %11.8f -> %11.8f\n", i, net.weights[i], fitted[i]);
+            net.weights[i] = fitted[i];
+        }
+        net.save_weights(output);
+        printf("generation %llu weights written to %s\n", static_cast<unsigned long long>(net.generation),
+               output.c_str());
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Perft for the game dynamics: counts the positions exactly depth moves
+// after a start position, stepping through every legal move of every
+// position on the way. A position where the game is over has no moves, so
+// the counts check step, is_terminal and the action maps together. Each
+// count is timed and reported in nodes per second.
+//
+// Usage: perft [--reference path]
+//            Checks every count in the reference file (default
+//            ../src/tools/perft_reference.txt) and exits 1 on a mismatch
+//        perft <game> <moves> <depth> [--divide]
+//            Counts depths 1 .. depth from the position after moves, with
+//            --divide splitting the deepest count by first move
+//
+// game is tictactoe, connect4-6, connect4-7 or connect4-8 (Connect4<N> on
+// an N x N board). moves are the moves from the empty board, - for none:
+// a digit per move, the column for Connect4 and the cell, 3 * row + col,
+// for TicTacToe. Chess is left out until its header builds.
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../game_dynamics/connect4.hpp"
+#include "../game_dynamics/tictactoe.hpp"
+
+// Positions depth moves on; leaf parents count their moves without making them
+template <typename Game>
+static uint64_t perft(Game& game, int depth){
+    if (depth == 0) return 1;
+    if (game.is_terminal()) return 0;
+    if (depth == 1) return game.num_actions;
+    uint64_t nodes = 0;
+    for (int i = 0; i < game.num_actions; i++){
+        Game child = game;
+        child.step(i);
+        nodes += perft(child, depth - 1);
+    }
+    return nodes;
+}
+
+// The action index playing a move from game, -1 if it is not legal there
+template <int N>
+static int find_action(Connect4<N>& game, int column){
+    for (int i = 0; i < game.num_actions; i++){
+        if (game.action_map[i] == column) return i;
+    }
+    return -1;
+}
+
+static int find_action(TicTacToe& game, int cell){
+    for (int i = 0; i < game.num_actions; i++){
+        if (game.action_map[i] == TicTacToe::ActionT(cell / 3, cell % 3)) return i;
+    }
+    return -1;
+}
+
+// Plays moves from the empty board into game; false if one is illegal
+template <typename Game>
+static bool play(Game& game, const std::string& moves){
+    if (moves == "-") return true;
+    for (char move : moves){
+        if (move < '0' || move > '9' || game.is_terminal()) return false;
+        int index = find_action(game, move - '0');
+        if (index == -1) return false;
+        game.step(index);
+    }
+    return true;
+}
+
+struct Timed {
+    uint64_t nodes;
+    double seconds;
+};
+
+template <typename Game>
+static Timed timed_perft(Game& game, int depth){
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = perft(game, depth);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return {nodes, elapsed.count()};
+}
+
+template <typename Game>
+static int report(const std::string& moves, int depth, bool divide){
+    Game game;
+    if (!play(game, moves)) {
+        fprintf(stderr, "Error: illegal moves %s\n", moves.c_str());
+        return 1;
+    }
+    for (int d = 1; d <= depth; d++){
+        Timed result = timed_perft(game, d);
+        printf("depth %2d  %14" PRIu64 " nodes  %8.3fs  %7.1fM nodes/s\n", d, result.nodes, result.seconds,
+               result.nodes / result.seconds / 1e6);
+    }
+    if (divide && depth > 0 && !game.is_terminal()) {
+        for (int i = 0; i < game.num_actions; i++){
+            Game child = game;
+            child.step(i);
+            printf("  action %d: %" PRIu64 "\n", i, perft(child, depth - 1));
+        }
+    }
+    return 0;
+}
+
+// Runs f<Game>() for the game named name; false if there is no such game
+template <typename F>
+static bool with_game(const std::string& name, F f){
+    if (name == "tictactoe") f(TicTacToe());
+    else if (name == "connect4-6") f(Connect4<6>());
+    else if (name == "connect4-7") f(Connect4<7>());
+    else if (name == "connect4-8") f(Connect4<8>());
+    else return false;
+    return true;
+}
+
+// Lines of "game moves depth nodes"; # starts a comment
+static int check(const std::string& path){
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Error: cannot read %s\n", path.c_str());
+        return 1;
+    }
+    int checked = 0, failed = 0;
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+    std::string line;
+    while (std::getline(file, line)){
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name, moves;
+        int depth;
+        uint64_t expected;
+        if (!(fields >> name >> moves >> depth >> expected)) {
+            fprintf(stderr, "Error: bad line in %s: %s\n", path.c_str(), line.c_str());
+            return 1;
+        }
+        bool known = with_game(name, [&](auto empty) {
+            auto game = empty;
+            Timed result{0, 0};
+            bool legal = play(game, moves);
+            if (legal) result = timed_perft(game, depth);
+            bool ok = legal && result.nodes == expected;
+            printf("%-11s %-12s depth %2d  %12" PRIu64 " nodes  %7.1fM nodes/s  %s\n", name.c_str(), moves.c_str(),
+                   depth, result.nodes, result.seconds > 0 ? result.nodes / result.seconds / 1e6 : 0.0,
+                   ok ? "ok" : "MISMATCH");
+            if (!ok) printf("  expected %" PRIu64 "\n", expected);
+            failed += !ok;
+            total_nodes += result.nodes;
+            total_seconds += result.seconds;
+        });
+        if (!known) {
+            fprintf(stderr, "Error: unknown game %s\n", name.c_str());
+            return 1;
+        }
+        checked++;
+    }
+    printf("%d of %d counts match, %" PRIu64 " nodes at %.1fM nodes/s\n", checked - failed, checked, total_nodes,
+           total_nodes / total_seconds / 1e6);
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv){
+    if (argc == 1 || (argc == 3 && strcmp(argv[1], "--reference") == 0)) {
+        return check(argc == 3 ? argv[2] : "../src/tools/perft_reference.txt");
+    }
+    if (argc < 4) {
+        fprintf(stderr, "Usage: perft [--reference path] | perft <game> <moves> <depth> [--divide]\n");
+        return 1;
+    }
+    std::string name = argv[1];
+    std::string moves = argv[2];
+    int depth = atoi(argv[3]);
+    bool divide = argc > 4 && strcmp(argv[4], "--divide") == 0;
+    int status = 1;
+    bool known = with_game(name, [&](auto empty) {
+        status = report<decltype(empty)>(moves, depth, divide);
+    });
+    if (!known) {
+        fprintf(stderr, "Error: unknown game %s\n", name.c_str());
+        return 1;
+    }
+    return status;
+}
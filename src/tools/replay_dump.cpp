@@ -0,0 +1,86 @@
+// Reads self-play replay shards. By default prints each shard's format and
+// a summary of its records; with --csv prints every record as a line of
+// features followed by the outcome, the layout of the old game_data.csv.
+//
+// Usage: replay_dump [--csv] shard...
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include "../replay_buffer.hpp"
+
+// Record i's outcome; throws if it is not a game result, as a corrupt or
+// foreign record would have it
+static int outcome(const char* path, const ReplayRecord& record, size_t i){
+    int result = record.outcome();
+    if (result < -1 || result > 1) {
+        throw std::runtime_error(std::string(path) + ": record " + std::to_string(i) + " is malformed, outcome "
+                                 + std::to_string(result));
+    }
+    return result;
+}
+
+static void summarise(const char* path, const ReplayReader& shard){
+    const ReplayFormat& format = shard.format();
+    printf("%s: %zu records of %u bytes, %u features%s%s\n", path, shard.size(), format.record_size(),
+           format.num_features, (format.flags & ReplayFormat::HAS_BOARD) ? ", board" : "",
+           (format.flags & ReplayFormat::HAS_VISITS) ? ", visits" : "");
+    size_t outcomes[3] = {0, 0, 0};
+    size_t games = 0;
+    double plies = 0, visits = 0;
+    for (size_t i = 0; i < shard.size(); i++){
+        ReplayRecord record = shard[i];
+        outcomes[outcome(path, record, i) + 1]++;
+        games += record.ply() == 0;
+        plies += record.ply();
+        if (const uint32_t* counts = record.visits()) {
+            for (uint32_t a = 0; a < format.num_actions; a++){
+                visits += counts[a];
+            }
+        }
+    }
+    if (shard.size() == 0) return;
+    printf("  %zu games, player 0 results +%zu =%zu -%zu (per position), mean ply %.1f",
+           games, outcomes[2], outcomes[1], outcomes[0], plies / shard.size());
+    if (format.flags & ReplayFormat::HAS_VISITS) {
+        printf(", mean root visits %.0f", visits / shard.size());
+    }
+    printf("\n");
+}
+
+static void print_csv(const char* path, const ReplayReader& shard){
+    const ReplayFormat& format = shard.format();
+    for (size_t i = 0; i < shard.size(); i++){
+        ReplayRecord record = shard[i];
+        int result = outcome(path, record, i);
+        for (uint32_t f = 0; f < format.num_features; f++){
+            printf("%g,", record.features()[f]);
+        }
+        printf("%d\n", result);
+    }
+}
+
+int main(int argc, char** argv){
+    bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+    int first = csv ? 2 : 1;
+    if (first >= argc) {
+        fprintf(stderr, "Usage: replay_dump [--csv] shard...\n");
+        return 1;
+    }
+    for (int i = first; i < argc; i++){
+        try {
+            ReplayReader shard(argv[i]);
+            if (csv) {
+                print_csv(argv[i], shard);
+            } else {
+                summarise(argv[i], shard);
+            }
+        } catch (const std::exception& e) {
+            fprintf(stderr, "Error: %s\n", e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#ifndef TRANSPOSITION_TABLE_HPP
+#define TRANSPOSITION_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// Maps position hashes to search nodes (node ids, or any handle with a null
+// value-initialised state) so that every move order reaching a position
+// shares one node. Sharded by hash so tree-parallel workers rarely contend on
+// the same lock. The table does not own nodes: callers pass a release
+// function when dropping entries.
+template<typename NodeT>
+class TranspositionTable{
+    private:
+    static constexpr int SHARD_BITS = 6;
+    static constexpr int NUM_SHARDS = 1 << SHARD_BITS;
+    static constexpr size_t CACHE_LINE = 64;
+
+    // A cache line of its own per shard, so neighbouring locks do not share one
+    struct alignas(CACHE_LINE) Shard{
+        std::mutex mtx;
+        std::unordered_map<uint64_t, NodeT> nodes;
+    };
+    Shard shards[NUM_SHARDS];
+
+    // Zobrist hashes are uniform, so the top bits pick the shard and the
+    // map's identity hash uses the low bits
+    Shard& shard_for(uint64_t hash){
+        return shards[hash >> (64 - SHARD_BITS)];
+    }
+
+    public:
+    TranspositionTable() = default;
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // NodeT{} when hash has no entry
+    NodeT find(uint64_t hash);
+
+    // Returns the node stored for hash, or stores and returns make_node().
+    // inserted tells the caller whether make_node ran.
+    template<typename MakeNode>
+    NodeT find_or_insert(uint64_t hash, MakeNode make_node, bool& inserted);
+
+    void insert(uint64_t hash, NodeT node);
+
+    // Drops every entry not in keep, handing each dropped node to release
+    template<typename Release>
+    void retain(const std::unordered_set<NodeT>& keep, Release release);
+
+    template<typename Release>
+    void clear(Release release);
+
+    size_t size();
+};
+
+template<typename NodeT>
+NodeT TranspositionTable<NodeT>::find(uint64_t hash){
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.nodes.find(hash);
+    return it == shard.nodes.end() ? NodeT{} : it->second;
+}
+
+template<typename NodeT>
+template<typename MakeNode>
+NodeT TranspositionTable<NodeT>::find_or_insert(uint64_t hash, MakeNode make_node, bool& inserted){
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto [it, is_new] = shard.nodes.try_emplace(hash, NodeT{});
+    if (is_new) {
+        it->second = make_node();
+    }
+    inserted = is_new;
+    return it->second;
+}
+
+template<typename NodeT>
+void TranspositionTable<NodeT>::insert(uint64_t hash, NodeT node){
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.nodes[hash] = node;
+}
+
+template<typename NodeT>
+template<typename Release>
+void TranspositionTable<NodeT>::retain(const std::unordered_set<NodeT>& keep, Release release){
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (auto it = shard.nodes.begin(); it != shard.nodes.end();) {
+            if (keep.count(it->second) == 0) {
+                release(it->second);
+                it = shard.nodes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+template<typename NodeT>
+template<typename Release>
+void TranspositionTable<NodeT>::clear(Release release){
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (auto& entry : shard.nodes) {
+            release(entry.second);
+        }
+        shard.nodes.clear();
+    }
+}
+
+template<typename NodeT>
+size_t TranspositionTable<NodeT>::size(){
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.nodes.size();
+    }
+    return total;
+}
+
+#endif // TRANSPOSITION_TABLE_HPP